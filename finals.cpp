@@ -18,6 +18,8 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <unordered_map>
+#include <map>
 
 
 // Advanced includes 
@@ -26,6 +28,31 @@
 #include <thread>   
 #include <filesystem> 
 #include <sys/stat.h> 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#define RECEIPTS_USE_OPENAT
+#define PARTITIONS_SUPPORTED
+#define CHECKPOINT_USE_FSYNC
+#endif
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <random>
+#include <cmath>
+#include <charconv>
+#include <string_view>
+#include <memory_resource>
+#include <tuple>
+#include <type_traits>
+#include <cstdio>
 
 using namespace std;
 
@@ -40,17 +67,534 @@ class TransactionLogger;
 // Global variables for system 
 const string TRANSACTION_LOG_FILE = "transaction_log.txt";
 const string RECEIPTS_DIR = "receipts/";
+const string LOCKBOX_ID_FILE = "lockbox_ids.txt";
+const string SCHEDULES_FILE = "schedules.txt";
+const string CHECKPOINT_FILE = "checkpoint.txt";
+const string PARTITIONS_FILE = "partitions.txt";
+const string DUE_INDEX_FILE = "due_index.txt";
+const string LEDGER_FILE = "ledger.txt";
+const string MEMORY_STATS_FILE = "memory_stats.txt";
+const string WORKLOAD_FILE = "workload.txt";
+
+
+// Utility function to split a '|' separated record line into fields
+vector<string> splitRecord(const string& line) {
+    vector<string> tokens;
+    size_t start = 0;
+    while (true) {
+        size_t end = line.find('|', start);
+        if (end == string::npos) {
+            if (start < line.size()) tokens.push_back(line.substr(start));
+            break;
+        }
+        tokens.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    return tokens;
+}
 
 
-// Utility function to get current date and time
-string getCurrentDateTime() {
-    time_t now = time(0);
-    tm* ltm = localtime(&now);
+// Memory accounting
+// Each subsystem allocates through its own MemoryAccount, a memory
+// resource that counts bytes and allocations before passing them on to
+// its upstream resource. Objects are created with allocate_shared, so the
+// shared_ptr control block is counted together with the object.
+class MemoryAccount : public pmr::memory_resource {
+public:
+    struct Stats {
+        string name;
+        long long bytesInUse = 0;
+        long long peakBytes = 0;
+        long long liveAllocations = 0;
+        long long totalAllocations = 0;
+
+        static constexpr auto recordFields() {
+            return make_tuple(&Stats::name, &Stats::bytesInUse, &Stats::peakBytes,
+                              &Stats::liveAllocations, &Stats::totalAllocations);
+        }
+    };
+
+private:
+    string name;
+    pmr::memory_resource* upstream;
+    atomic<long long> bytesInUse{0};
+    atomic<long long> peakBytes{0};
+    atomic<long long> liveAllocations{0};
+    atomic<long long> totalAllocations{0};
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* memory = upstream->allocate(bytes, alignment);
+        long long inUse = bytesInUse.fetch_add(static_cast<long long>(bytes)) + static_cast<long long>(bytes);
+        long long peak = peakBytes.load();
+        while (inUse > peak && !peakBytes.compare_exchange_weak(peak, inUse)) {
+        }
+        liveAllocations++;
+        totalAllocations++;
+        return memory;
+    }
+
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+        upstream->deallocate(memory, bytes, alignment);
+        bytesInUse -= static_cast<long long>(bytes);
+        liveAllocations--;
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    MemoryAccount(const string& accountName, pmr::memory_resource* next = pmr::new_delete_resource())
+        : name(accountName), upstream(next) {}
+
+    // Only allowed before the first allocation, since memory has to be
+    // returned to the resource it came from
+    bool setUpstream(pmr::memory_resource* next) {
+        if (totalAllocations > 0) return false;
+        upstream = next;
+        return true;
+    }
+
+    Stats getStats() const {
+        return Stats{name, bytesInUse.load(), peakBytes.load(), liveAllocations.load(), totalAllocations.load()};
+    }
+};
+
+
+// The accounts of every subsystem. Long-lived data (users, lock boxes,
+// the release log) goes to the heap by default, or to a shared size-class
+// pool with --memory=pool. Records read during a bulk load live in a
+// monotonic arena drawn from loadScratch and released in one piece once
+// the load is installed.
+class MemoryAccounts {
+public:
+    enum Mode { HEAP, POOL };
+
+    MemoryAccount users{"users"};
+    MemoryAccount lockBoxes{"lockBoxes"};
+    MemoryAccount releaseLog{"releaseLog"};
+    MemoryAccount loadScratch{"loadScratch"};
+    MemoryAccount poolReserve{"poolReserve"};   // What the pool takes from the heap
+
+private:
+    pmr::synchronized_pool_resource pool{&poolReserve};
+    Mode mode = HEAP;
+
+public:
+    // Choose where long-lived data goes; call before anything is loaded
+    bool configure(Mode newMode) {
+        pmr::memory_resource* upstream = newMode == POOL ? static_cast<pmr::memory_resource*>(&pool)
+                                                         : pmr::new_delete_resource();
+        bool changed = true;
+        for (MemoryAccount* account : {&users, &lockBoxes, &releaseLog}) {
+            changed = account->setUpstream(upstream) && changed;
+        }
+        if (changed) mode = newMode;
+        return changed;
+    }
+
+    static bool parseMode(const string& name, Mode& result) {
+        if (name == "heap") result = HEAP;
+        else if (name == "pool") result = POOL;
+        else return false;
+        return true;
+    }
+
+    const char* getModeName() const {
+        return mode == POOL ? "pool" : "heap";
+    }
+
+    vector<MemoryAccount::Stats> getStats() const {
+        vector<MemoryAccount::Stats> stats;
+        for (const MemoryAccount* account : {&users, &lockBoxes, &releaseLog, &loadScratch}) {
+            stats.push_back(account->getStats());
+        }
+        if (mode == POOL) stats.push_back(poolReserve.getStats());
+        return stats;
+    }
+};
+
+MemoryAccounts memoryAccounts;
+
+
+// Types that name their account with a static memoryAccount() are
+// allocated through it; everything else uses make_shared
+template <typename T, typename = void>
+struct HasMemoryAccount : false_type {};
+
+template <typename T>
+struct HasMemoryAccount<T, void_t<decltype(T::memoryAccount())>> : true_type {};
+
+template <typename T, typename... Args>
+shared_ptr<T> makeAccounted(Args&&... args) {
+    using Object = remove_const_t<T>;
+    if constexpr (HasMemoryAccount<Object>::value) {
+        return allocate_shared<Object>(pmr::polymorphic_allocator<Object>(&Object::memoryAccount()),
+                                       forward<Args>(args)...);
+    } else {
+        return make_shared<Object>(forward<Args>(args)...);
+    }
+}
+
+
+// Record codec
+// A persisted type lists its fields once, in recordFields(), as member
+// pointers in file order. Types with constructors take the same order in
+// their loading constructor. The '|' separated encoder and decoder are
+// generated from that list, so save and load can't drift apart. Fields
+// are unrolled at compile time, numbers go through to_chars/from_chars,
+// and encoding appends to a buffer the caller can reuse.
+// Doubles are written in shortest round-trip form, so an amount reloads
+// as exactly the same value and the checkpoint totals (in cents) match.
+// Files written before the codec (six significant digits, e.g. "1e+06")
+// still parse. Strings are escaped so a '|' or line break inside a field
+// can't split the record.
+namespace RecordCodec {
+
+    // A backslash, '|' and a line break are written as two backslashes,
+    // \p and \n. Other backslashes are read back as they are, so older
+    // files without escapes still load.
+    inline void appendEscaped(string& out, string_view text) {
+        if (text.find_first_of("\\|\n") == string_view::npos) {
+            out.append(text.data(), text.size());
+            return;
+        }
+        for (char c : text) {
+            if (c == '\\') out += "\\\\";
+            else if (c == '|') out += "\\p";
+            else if (c == '\n') out += "\\n";
+            else out += c;
+        }
+    }
+
+    inline void unescape(string_view text, string& value) {
+        value.clear();
+        value.reserve(text.size());
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '\\' && i + 1 < text.size()) {
+                char next = text[i + 1];
+                if (next == '\\' || next == 'p' || next == 'n') {
+                    value += next == 'p' ? '|' : next == 'n' ? '\n' : '\\';
+                    i++;
+                    continue;
+                }
+            }
+            value += text[i];
+        }
+    }
+
+    template <typename Member> struct MemberType;
+    template <typename Owner, typename T> struct MemberType<T Owner::*> { using type = T; };
+
+    template <typename Record, size_t I>
+    using FieldType = typename MemberType<tuple_element_t<I, decltype(Record::recordFields())>>::type;
+
+    template <typename T>
+    void encodeField(string& out, const T& value) {
+        if constexpr (is_same_v<T, string>) {
+            appendEscaped(out, value);
+        } else if constexpr (is_same_v<T, bool>) {
+            out += value ? '1' : '0';
+        } else if constexpr (is_enum_v<T>) {
+            encodeField(out, static_cast<underlying_type_t<T>>(value));
+        } else {
+            char digits[32];
+            auto result = to_chars(digits, digits + sizeof(digits), value);
+            out.append(digits, result.ptr);
+        }
+    }
+
+    template <typename T>
+    bool decodeField(string_view text, T& value) {
+        if constexpr (is_same_v<T, string>) {
+            if (text.find('\\') == string_view::npos) {
+                value.assign(text.data(), text.size());
+            } else {
+                unescape(text, value);
+            }
+            return true;
+        } else if constexpr (is_same_v<T, bool>) {
+            int flag;
+            if (!decodeField(text, flag)) return false;
+            value = flag == 1;
+            return true;
+        } else if constexpr (is_enum_v<T>) {
+            underlying_type_t<T> raw;
+            if (!decodeField(text, raw)) return false;
+            value = static_cast<T>(raw);
+            return true;
+        } else {
+            const char* end = text.data() + text.size();
+            auto result = from_chars(text.data(), end, value);
+            return result.ec == errc() && result.ptr == end;
+        }
+    }
+
+    // Split the first count fields; anything after them is ignored
+    inline bool splitFields(string_view line, string_view* fields, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            size_t end = line.find('|');
+            if (end == string_view::npos) {
+                if (i + 1 < count) return false;
+                end = line.size();
+            }
+            fields[i] = line.substr(0, end);
+            line.remove_prefix(min(end + 1, line.size()));
+        }
+        return true;
+    }
+
+    template <typename Record, size_t... I>
+    void encodeFields(const Record& record, string& out, index_sequence<I...>) {
+        constexpr auto fields = Record::recordFields();
+        ((I == 0 ? void() : void(out += '|'), encodeField(out, record.*get<I>(fields))), ...);
+    }
+
+    template <typename Record, size_t... I>
+    shared_ptr<Record> decodeFields(string_view line, index_sequence<I...>) {
+        string_view text[sizeof...(I)];
+        tuple<FieldType<Record, I>...> values;
+        if (!splitFields(line, text, sizeof...(I)) || !(decodeField(text[I], get<I>(values)) && ...)) {
+            return nullptr;
+        }
+        if constexpr (is_aggregate_v<Record>) {
+            constexpr auto fields = Record::recordFields();
+            auto record = makeAccounted<Record>();
+            ((record.get()->*get<I>(fields) = move(get<I>(values))), ...);
+            return record;
+        } else {
+            return makeAccounted<Record>(move(get<I>(values))...);
+        }
+    }
+
+    // Append one record (without a line break) to out
+    template <typename Record>
+    void encode(const Record& record, string& out) {
+        constexpr size_t count = tuple_size_v<decltype(Record::recordFields())>;
+        encodeFields(record, out, make_index_sequence<count>());
+    }
+
+    // Write one record as a line
+    template <typename Record>
+    void write(ostream& file, const Record& record) {
+        string line;
+        encode(record, line);
+        line += '\n';
+        file << line;
+    }
+
+    // Decode one record line, nullptr if a field is missing or malformed
+    template <typename Record>
+    shared_ptr<Record> decode(string_view line) {
+        constexpr size_t count = tuple_size_v<decltype(Record::recordFields())>;
+        return decodeFields<Record>(line, make_index_sequence<count>());
+    }
+}
+
+// System clock
+// Wall-clock time by default. The workload harness switches it to a
+// virtual clock so hours of simulated time can be replayed in seconds.
+class Clock {
+private:
+    static atomic<bool> virtualMode;
+    static atomic<time_t> virtualNow;
+    static atomic<long long> steadyOffsetMs;    // Keeps steadyMs() monotonic across switches
+
+    static long long realSteadyMs() {
+        static const auto origin = chrono::steady_clock::now();
+        return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - origin).count();
+    }
+
+public:
+    static time_t now() {
+        return virtualMode.load(memory_order_relaxed) ? virtualNow.load(memory_order_relaxed) : time(0);
+    }
+
+    // Monotonic milliseconds for rate limits. Follows virtual time while it
+    // is on, so a replayed day refills buckets like a real one.
+    static long long steadyMs() {
+        long long offset = steadyOffsetMs.load(memory_order_relaxed);
+        if (virtualMode.load(memory_order_relaxed)) {
+            return offset + static_cast<long long>(virtualNow.load(memory_order_relaxed)) * 1000;
+        }
+        return offset + realSteadyMs();
+    }
+
+    // Switch to virtual time starting at the given instant
+    static void useVirtual(time_t start) {
+        long long current = steadyMs();
+        virtualNow.store(start);
+        steadyOffsetMs.store(current - static_cast<long long>(start) * 1000);
+        virtualMode.store(true);
+    }
+
+    // Move virtual time forward (never backwards)
+    static void advanceTo(time_t t) {
+        if (t > virtualNow.load()) {
+            virtualNow.store(t);
+        }
+    }
+
+    static void useReal() {
+        long long current = steadyMs();
+        steadyOffsetMs.store(current - realSteadyMs());
+        virtualMode.store(false);
+    }
+};
+
+atomic<bool> Clock::virtualMode(false);
+atomic<time_t> Clock::virtualNow(0);
+atomic<long long> Clock::steadyOffsetMs(0);
+
+
+// Format a time as a local date and time
+string formatDateTime(time_t value) {
+    tm* ltm = localtime(&value);
     char buffer[80];
     strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", ltm);
     return string(buffer);
 }
 
+// Utility function to get current date and time
+string getCurrentDateTime() {
+    return formatDateTime(Clock::now());
+}
+
+// Parse a local date and time written by getCurrentDateTime
+bool parseDateTime(const string& text, time_t& result) {
+    tm local = {};
+    if (sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &local.tm_year, &local.tm_mon, &local.tm_mday,
+               &local.tm_hour, &local.tm_min, &local.tm_sec) != 6) {
+        return false;
+    }
+    local.tm_year -= 1900;
+    local.tm_mon -= 1;
+    local.tm_isdst = -1;
+    result = mktime(&local);
+    return result != -1;
+}
+
+// Buffered console renderer for listings
+// Rows are formatted into one reusable buffer and written to cout in large
+// chunks instead of flushing every line. Numbers are formatted without
+// streams and dates are cached per hour. With a page size set, the user
+// is asked once the first row past a full page has been rendered, so there
+// is no prompt after the last page.
+class ConsoleRenderer {
+public:
+    static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+private:
+    string buffer;
+    size_t pageSize;
+    size_t rows = 0;
+    bool stopped = false;
+
+    // Date cache: the formatted hour is reused for every timestamp inside it
+    time_t cachedHourStart = -1;
+    char cachedPrefix[32];      // "Www Mmm dd hh:"
+    char cachedYear[8];         // " yyyy"
+
+    void appendTwoDigits(int value) {
+        buffer += static_cast<char>('0' + value / 10);
+        buffer += static_cast<char>('0' + value % 10);
+    }
+
+public:
+    ConsoleRenderer(size_t rowsPerPage = 0) : pageSize(rowsPerPage) {
+        buffer.reserve(FLUSH_THRESHOLD + 1024);
+    }
+
+    ~ConsoleRenderer() { flush(); }
+
+    ConsoleRenderer& text(const string& value) {
+        buffer += value;
+        return *this;
+    }
+
+    ConsoleRenderer& text(const char* value) {
+        buffer += value;
+        return *this;
+    }
+
+    ConsoleRenderer& integer(long long value) {
+        char digits[24];
+        auto result = to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr);
+        return *this;
+    }
+
+    // Fixed two-decimal amount, same output as fixed << setprecision(2)
+    ConsoleRenderer& money(double value) {
+        if (!isfinite(value) || fabs(value) >= 9e16) {
+            char digits[64];
+            int length = snprintf(digits, sizeof(digits), "%.2f", value);
+            buffer.append(digits, max(length, 0));
+            return *this;
+        }
+        long long cents = llround(value * 100.0);
+        if (cents < 0) {
+            buffer += '-';
+            cents = -cents;
+        }
+        integer(cents / 100);
+        buffer += '.';
+        appendTwoDigits(static_cast<int>(cents % 100));
+        return *this;
+    }
+
+    // Local date in ctime() layout, without the trailing newline
+    ConsoleRenderer& date(time_t value) {
+        if (cachedHourStart < 0 || value < cachedHourStart || value >= cachedHourStart + 3600) {
+            tm local;
+            localtime_r(&value, &local);
+            cachedHourStart = value - local.tm_min * 60 - local.tm_sec;
+            strftime(cachedPrefix, sizeof(cachedPrefix), "%a %b %e %H:", &local);
+            strftime(cachedYear, sizeof(cachedYear), " %Y", &local);
+        }
+        long long offset = value - cachedHourStart;
+        buffer += cachedPrefix;
+        appendTwoDigits(static_cast<int>(offset / 60));
+        buffer += ':';
+        appendTwoDigits(static_cast<int>(offset % 60));
+        buffer += cachedYear;
+        return *this;
+    }
+
+    // Finish a row. Returns false once the user stops paging.
+    bool endRow() {
+        buffer += '\n';
+        rows++;
+        if (pageSize > 0 && rows > pageSize && (rows - 1) % pageSize == 0) {
+            // The page before was flushed, so only this row is buffered
+            cout << "-- Showing " << rows - 1 << " rows. Enter n for next page, q to stop: ";
+            string answer;
+            cin >> answer;
+            if (answer != "n" && answer != "N") {
+                stopped = true;
+                buffer.clear();
+                rows--;
+                return false;
+            }
+        }
+        if (buffer.size() >= FLUSH_THRESHOLD || (pageSize > 0 && rows % pageSize == 0)) {
+            flush();
+        }
+        return true;
+    }
+
+    bool isStopped() const { return stopped; }
+    size_t getRowCount() const { return rows; }
+
+    void flush() {
+        if (!buffer.empty()) {
+            cout.write(buffer.data(), buffer.size());
+            cout.flush();
+            buffer.clear();
+        }
+    }
+};
+
 // Abstract Base Class
 class Person {
 protected:
@@ -73,7 +617,7 @@ public:
 
     // Accessor methods
     string getUsername() const { return username; }
-    string getPassword() const { return password; } // Only used for saving data
+    string getPassword() const { return password; } // Only used for saving data and workload replay
     string getRegistrationDate() const { return registrationDate; }
 
     // Password verification
@@ -85,13 +629,308 @@ public:
     virtual void displayDetails() const = 0;
 
     // Virtual method for file saving
-    virtual void saveToFile(ofstream& file) const {
+    virtual void saveToFile(ostream& file) const {
         file << username << "|"
             << password << "|"
             << registrationDate << endl;
     }
 };
 
+// Receipt directory layout manager
+// Creates the receipts tree once and remembers which user directories
+// exist, so logging and receipts no longer stat the directories on every
+// write. On POSIX systems the root and a bounded number of user
+// directories are held open and files are created with openat().
+class ReceiptLayout {
+public:
+    static const size_t MAX_OPEN_DIRS = 256;
+
+private:
+    mutex mtx;
+    bool rootReady = false;
+    unordered_map<string, int> knownDirs;   // Username -> dir fd (-1 if not held open)
+#ifdef RECEIPTS_USE_OPENAT
+    int rootFd = -1;
+    size_t openDirs = 0;
+#endif
+
+    // Create the root directory and learn the existing user directories (mtx held)
+    void prepareRoot() {
+        if (rootReady) return;
+        error_code ec;
+        filesystem::create_directories(RECEIPTS_DIR, ec);
+        for (const auto& entry : filesystem::directory_iterator(RECEIPTS_DIR, ec)) {
+            if (entry.is_directory(ec)) {
+                knownDirs.emplace(entry.path().filename().string(), -1);
+            }
+        }
+#ifdef RECEIPTS_USE_OPENAT
+        rootFd = open(RECEIPTS_DIR.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+        rootReady = true;
+    }
+
+    // Make sure a user's directory exists, returns its fd or -1 (mtx held)
+    int prepareUserDir(const string& username) {
+        prepareRoot();
+        auto it = knownDirs.find(username);
+        if (it != knownDirs.end() && it->second >= 0) {
+            return it->second;
+        }
+
+        int fd = -1;
+#ifdef RECEIPTS_USE_OPENAT
+        if (rootFd >= 0) {
+            if (it == knownDirs.end()) {
+                mkdirat(rootFd, username.c_str(), 0755);
+            }
+            if (openDirs < MAX_OPEN_DIRS) {
+                fd = openat(rootFd, username.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                if (fd >= 0) openDirs++;
+            }
+        }
+#endif
+        if (it == knownDirs.end() && fd < 0) {
+            error_code ec;
+            filesystem::create_directory(RECEIPTS_DIR + username, ec);
+        }
+        knownDirs[username] = fd;
+        return fd;
+    }
+
+public:
+    ~ReceiptLayout() {
+#ifdef RECEIPTS_USE_OPENAT
+        for (auto& entry : knownDirs) {
+            if (entry.second >= 0) close(entry.second);
+        }
+        if (rootFd >= 0) close(rootFd);
+#endif
+    }
+
+    // Create the receipts tree and load the set of existing user directories
+    void prepare() {
+        lock_guard<mutex> guard(mtx);
+        prepareRoot();
+    }
+
+    // Create a user's receipt directory ahead of time (e.g. at registration)
+    void ensureUserDir(const string& username) {
+        lock_guard<mutex> guard(mtx);
+        prepareUserDir(username);
+    }
+
+    // Write data to a file in the user's directory, appending or replacing
+    bool writeFile(const string& username, const string& filename, const string& data, bool append) {
+        int dirFd;
+        {
+            lock_guard<mutex> guard(mtx);
+            dirFd = prepareUserDir(username);
+        }
+
+#ifdef RECEIPTS_USE_OPENAT
+        if (dirFd >= 0) {
+            int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC);
+            int fd = openat(dirFd, filename.c_str(), flags, 0644);
+            if (fd < 0) return false;
+            const char* cursor = data.data();
+            size_t remaining = data.size();
+            while (remaining > 0) {
+                ssize_t written = write(fd, cursor, remaining);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    close(fd);
+                    return false;
+                }
+                cursor += written;
+                remaining -= static_cast<size_t>(written);
+            }
+            close(fd);
+            return true;
+        }
+#endif
+        (void)dirFd;
+        ofstream file(RECEIPTS_DIR + username + "/" + filename, append ? ios::app : ios::trunc);
+        if (!file.is_open()) return false;
+        file << data;
+        return true;
+    }
+};
+
+ReceiptLayout receiptLayout;
+
+
+// Asynchronous file writer
+// Log appends, receipts and checkpoint files are handed to a small pool of
+// I/O threads, so a slow disk stalls those threads instead of the ones
+// serving users. Each file always goes to the same thread, which keeps its
+// writes in order. A thread takes its whole queue at once and merges the
+// appends to one file into a single write.
+class AsyncWriter {
+public:
+    static const size_t IO_THREADS = 2;
+    using Completion = function<void(bool)>;
+
+private:
+    struct WriteRequest {
+        string username;    // Owner of the receipt directory, empty for a plain path
+        string name;        // File name in that directory, or the path
+        string data;
+        bool append;
+        Completion done;
+        bool durable = false;   // Flushed to disk before completing
+    };
+
+    struct Lane {
+        mutex mtx;
+        condition_variable ready;
+        condition_variable idle;
+        vector<WriteRequest> queue;
+        bool busy = false;
+        bool stopping = false;
+        thread worker;
+    };
+
+    Lane lanes[IO_THREADS];
+
+    static bool perform(const WriteRequest& request, const string& data, bool append) {
+        if (!request.username.empty()) {
+            return receiptLayout.writeFile(request.username, request.name, data, append);
+        }
+#ifdef CHECKPOINT_USE_FSYNC
+        if (request.durable) {
+            int fd = open(request.name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) return false;
+            size_t written = 0;
+            while (written < data.size()) {
+                ssize_t count = ::write(fd, data.data() + written, data.size() - written);
+                if (count < 0 && errno == EINTR) continue;
+                if (count <= 0) break;
+                written += static_cast<size_t>(count);
+            }
+            bool ok = written == data.size() && fsync(fd) == 0;
+            return close(fd) == 0 && ok;
+        }
+#endif
+        ofstream file(request.name, append ? ios::app : ios::trunc);
+        if (!file.is_open()) return false;
+        file << data;
+        file.flush();
+        return file.good();
+    }
+
+    // Write one file's requests in order, merging consecutive appends
+    static void writeGroup(vector<WriteRequest*>& group) {
+        size_t start = 0;
+        while (start < group.size()) {
+            size_t end = start + 1;
+            bool written;
+            if (group[start]->append) {
+                string merged = move(group[start]->data);
+                while (end < group.size() && group[end]->append) {
+                    merged += group[end]->data;
+                    end++;
+                }
+                written = perform(*group[start], merged, true);
+            } else {
+                written = perform(*group[start], group[start]->data, false);
+            }
+            for (size_t i = start; i < end; i++) {
+                if (group[i]->done) group[i]->done(written);
+            }
+            start = end;
+        }
+    }
+
+    void run(Lane& lane) {
+        vector<WriteRequest> batch;
+        while (true) {
+            {
+                unique_lock<mutex> lock(lane.mtx);
+                lane.ready.wait(lock, [&lane] { return !lane.queue.empty() || lane.stopping; });
+                if (lane.queue.empty()) return;  // Stopping and fully drained
+                batch.swap(lane.queue);
+                lane.busy = true;
+            }
+
+            // Group by file, keeping first-seen order
+            unordered_map<string, size_t> groupOf;
+            vector<vector<WriteRequest*>> groups;
+            for (auto& request : batch) {
+                auto inserted = groupOf.emplace(request.username + "/" + request.name, groups.size());
+                if (inserted.second) groups.emplace_back();
+                groups[inserted.first->second].push_back(&request);
+            }
+            for (auto& group : groups) {
+                writeGroup(group);
+            }
+            batch.clear();
+
+            {
+                lock_guard<mutex> lock(lane.mtx);
+                lane.busy = false;
+            }
+            lane.idle.notify_all();
+        }
+    }
+
+    // Queue a request on its file's lane, starting the lane's thread if needed
+    void submit(WriteRequest request) {
+        Lane& lane = lanes[hash<string>{}(request.username + "/" + request.name) % IO_THREADS];
+        {
+            lock_guard<mutex> lock(lane.mtx);
+            if (!lane.worker.joinable()) {
+                lane.stopping = false;
+                lane.worker = thread(&AsyncWriter::run, this, ref(lane));
+            }
+            lane.queue.push_back(move(request));
+        }
+        lane.ready.notify_one();
+    }
+
+public:
+    ~AsyncWriter() { stop(); }
+
+    // Append to or replace a file in a user's receipt directory
+    void writeUserFile(const string& username, const string& name, string data, bool append,
+                       Completion done = nullptr) {
+        submit(WriteRequest{username, name, move(data), append, move(done)});
+    }
+
+    // Replace the file at a path; the future tells whether it was written.
+    // A durable write is on disk (fsync) before the future is ready.
+    future<bool> writeFile(const string& path, string data, bool durable = false) {
+        auto written = make_shared<promise<bool>>();
+        future<bool> result = written->get_future();
+        submit(WriteRequest{"", path, move(data), false,
+                            [written](bool ok) { written->set_value(ok); }, durable});
+        return result;
+    }
+
+    // Wait until every queued write has finished
+    void flush() {
+        for (auto& lane : lanes) {
+            unique_lock<mutex> lock(lane.mtx);
+            lane.idle.wait(lock, [&lane] { return lane.queue.empty() && !lane.busy; });
+        }
+    }
+
+    // Finish what is queued and stop the I/O threads
+    void stop() {
+        for (auto& lane : lanes) {
+            {
+                lock_guard<mutex> lock(lane.mtx);
+                if (!lane.worker.joinable()) continue;
+                lane.stopping = true;
+            }
+            lane.ready.notify_all();
+            lane.worker.join();
+        }
+    }
+};
+
+AsyncWriter asyncWriter;
+
 // Transaction Logger class
 class TransactionLogger {
 public:
@@ -104,7 +943,9 @@ public:
         CREATE_LOCKBOX,
         RELEASE_LOCKBOX,
         BALANCE_UPDATE,
-        USER_STATUS_CHANGE
+        USER_STATUS_CHANGE,
+        CREATE_SCHEDULE,
+        LOGIN_FAILURE
     };
 
     // Log transaction to file
@@ -112,85 +953,80 @@ public:
         TransactionType type,
         const string& username,
         const string& details = "",
-        double amount = 0.0
+        double amount = 0.0,
+        long long lockBoxId = -1
     ) {
-        // Create receipts directory if it doesn't exist
-        if (!filesystem::exists(RECEIPTS_DIR)) {
-            filesystem::create_directory(RECEIPTS_DIR);
-        }
-        // Create user directory if it doesn't exist
-        string userDir = RECEIPTS_DIR + username + "/";
-        if (!filesystem::exists(userDir)) {
-            filesystem::create_directory(userDir);
-        }
-        // User-specific transaction log file
-        string userLogFile = userDir + "transaction_log.txt";
-        ofstream logFile(userLogFile, ios::app);
-        if (logFile.is_open()) {
-            logFile << getCurrentDateTime() << "|"
-                    << getTransactionTypeName(type) << "|"
-                    << username << "|"
-                    << amount << "|"
-                    << details << endl;
-            logFile.close();
-        }
+        // User-specific transaction log file (directories are managed by receiptLayout)
+        string line = getCurrentDateTime();
+        line += '|';
+        line += getTransactionTypeName(type);
+        line += '|';
+        RecordCodec::encodeField(line, username);
+        line += '|';
+        RecordCodec::encodeField(line, amount);
+        line += '|';
+        RecordCodec::encodeField(line, details);
+        line += '|';
+        RecordCodec::encodeField(line, lockBoxId);
+        line += '\n';
+        asyncWriter.writeUserFile(username, "transaction_log.txt", move(line), true);
     }
 
-    // Generate receipt for transaction
+    // Generate receipt for transaction; onWritten gets the receipt path once it is on disk
     static void generateReceipt(
         TransactionType type,
         const string& username,
         const string& details,
         double amount,
-        int lockBoxId = -1
+        long long lockBoxId = -1,
+        function<void(const string&)> onWritten = nullptr
     ) {
-        // Create receipts directory if it doesn't exist
-        if (!filesystem::exists(RECEIPTS_DIR)) {
-            filesystem::create_directory(RECEIPTS_DIR);
-        }
-
-        // Create user directory if it doesn't exist
-        string userDir = RECEIPTS_DIR + username + "/";
-        if (!filesystem::exists(userDir)) {
-            filesystem::create_directory(userDir);
-        }
-
         // Generate unique receipt filename
         string timestamp = getCurrentDateTime();
         replace(timestamp.begin(), timestamp.end(), ' ', '_');
         replace(timestamp.begin(), timestamp.end(), ':', '-');
 
-        string receiptFile = userDir + getTransactionTypeName(type) + "_" +
-                                timestamp + ".txt";
+        string receiptName = getTransactionTypeName(type) + "_" + timestamp + ".txt";
 
-        ofstream receipt(receiptFile);
-        if (receipt.is_open()) {
-            receipt << "=== TIME-LOCKED SAVINGS SYSTEM RECEIPT ===\n";
-            receipt << "Date & Time: " << getCurrentDateTime() << "\n";
-            receipt << "Transaction Type: " << getTransactionTypeName(type) << "\n";
-            receipt << "Username: " << username << "\n";
+        stringstream receipt;
+        receipt << "=== TIME-LOCKED SAVINGS SYSTEM RECEIPT ===\n";
+        receipt << "Date & Time: " << getCurrentDateTime() << "\n";
+        receipt << "Transaction Type: " << getTransactionTypeName(type) << "\n";
+        receipt << "Username: " << username << "\n";
 
-            if (lockBoxId != -1) {
-                receipt << "Lock Box ID: " << lockBoxId << "\n";
-            }
+        if (lockBoxId != -1) {
+            receipt << "Lock Box ID: " << lockBoxId << "\n";
+        }
 
-            if (amount != 0.0) {
-                receipt << "Amount: $" << fixed << setprecision(2) << amount << "\n";
-            }
+        if (amount != 0.0) {
+            receipt << "Amount: $" << fixed << setprecision(2) << amount << "\n";
+        }
 
-            if (!details.empty()) {
-                receipt << "Details: " << details << "\n";
-            }
+        if (!details.empty()) {
+            receipt << "Details: " << details << "\n";
+        }
+
+        receipt << "=======================================\n";
+        receipt << "Thank you for using our Time-Locked Savings System!\n";
 
-            receipt << "=======================================\n";
-            receipt << "Thank you for using our Time-Locked Savings System!\n";
-            receipt.close();
+        string path = RECEIPTS_DIR + username + "/" + receiptName;
+        asyncWriter.writeUserFile(username, receiptName, receipt.str(), false,
+            [path, onWritten](bool written) {
+                if (written && onWritten) onWritten(path);
+            });
+    }
 
-            cout << "Receipt generated: " << receiptFile << endl;
+    // Transaction type from its logged name, false if unknown
+    static bool parseTransactionType(const string& name, TransactionType& type) {
+        for (int value = USER_REGISTRATION; value <= LOGIN_FAILURE; value++) {
+            if (getTransactionTypeName(static_cast<TransactionType>(value)) == name) {
+                type = static_cast<TransactionType>(value);
+                return true;
+            }
         }
+        return false;
     }
 
-private:
     // Helper method to get transaction type name
     static string getTransactionTypeName(TransactionType type) {
         switch (type) {
@@ -203,692 +1039,4377 @@ private:
             case RELEASE_LOCKBOX: return "RELEASE_LOCKBOX";
             case BALANCE_UPDATE: return "BALANCE_UPDATE";
             case USER_STATUS_CHANGE: return "USER_STATUS_CHANGE";
+            case CREATE_SCHEDULE: return "CREATE_SCHEDULE";
+            case LOGIN_FAILURE: return "LOGIN_FAILURE";
             default: return "UNKNOWN";
         }
     }
 };
 
-// User class 
-class User : public Person {
-private:
-   double balance;
-   vector<shared_ptr<LockBox>> lockBoxes;
-   bool active;
+// Event published on the event bus for every transaction
+struct SystemEvent {
+    TransactionLogger::TransactionType type;
+    string username;
+    string details;
+    double amount;
+    long long lockBoxId;
+    shared_ptr<ReleaseEvent> release;   // Set for RELEASE_LOCKBOX events
+
+    SystemEvent(TransactionLogger::TransactionType t, const string& uname,
+                const string& det = "", double amt = 0.0, long long boxId = -1,
+                shared_ptr<ReleaseEvent> rel = nullptr)
+        : type(t), username(uname), details(det), amount(amt), lockBoxId(boxId), release(rel) {}
+};
 
+// In-process event bus
+// Publishers enqueue events and return immediately; a worker thread
+// dispatches them in batches to the registered subscribers. The queue is
+// bounded, so publishers wait when subscribers fall too far behind.
+class EventBus {
 public:
-// Constructor 
-User(const string& uname, const string& pass, double initialBalance = 1000.0)
-       : Person(uname, pass), balance(initialBalance), active(true) {}
+    using Subscriber = function<void(const SystemEvent&)>;
+    static const size_t MAX_PENDING = 4096;
 
-// Constructor for loading from file
-  User(const string& uname, const string& pass, double initialBalance,
-       bool isActive, const string& regDate)
-       : Person(uname, pass, regDate), balance(initialBalance), active(isActive) {}
+private:
+    struct Subscription {
+        bool allTypes;
+        TransactionLogger::TransactionType type;
+        Subscriber callback;
+    };
 
-// Accessor methods 
-double getBalance() const { return balance; }
-   bool isActive() const { return active; }
+    mutex queueMutex;
+    condition_variable notEmpty;
+    condition_variable notFull;
+    condition_variable drained;
+    vector<SystemEvent> pending;
+    bool dispatching = false;
+    bool stopping = false;
+    bool running = false;       // Worker will still drain pending
+    thread worker;
+
+    mutex subscriberMutex;
+    vector<Subscription> subscribers;
+
+    static thread_local vector<SystemEvent>* deferred;
+
+    void dispatch(const SystemEvent& event) {
+        lock_guard<mutex> guard(subscriberMutex);
+        for (const auto& sub : subscribers) {
+            if (sub.allTypes || sub.type == event.type) {
+                sub.callback(event);
+            }
+        }
+    }
+
+    void run() {
+        vector<SystemEvent> batch;
+        while (true) {
+            {
+                unique_lock<mutex> lock(queueMutex);
+                notEmpty.wait(lock, [this] { return !pending.empty() || stopping; });
+                if (pending.empty()) {
+                    running = false;  // Stopping and fully drained
+                    return;
+                }
+                batch.swap(pending);
+                dispatching = true;
+            }
+            notFull.notify_all();
+
+            for (const auto& event : batch) {
+                dispatch(event);
+            }
+            batch.clear();
+
+            {
+                lock_guard<mutex> lock(queueMutex);
+                dispatching = false;
+            }
+            drained.notify_all();
+        }
+    }
+
+public:
+    // Holds back the events this thread publishes while it exists and
+    // publishes them when it goes out of scope. Declare it before a user
+    // lock_guard so a full queue never blocks while the lock is held.
+    class Batch {
+    private:
+        vector<SystemEvent> events;
+        vector<SystemEvent>* previous;
+        EventBus& bus;
+
+    public:
+        explicit Batch(EventBus& target) : previous(deferred), bus(target) {
+            deferred = &events;
+        }
+
+        ~Batch() {
+            deferred = previous;
+            for (const auto& event : events) {
+                bus.publish(event);
+            }
+        }
+
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+    };
+
+    ~EventBus() { stop(); }
+
+    // Subscribe to one transaction type
+    void subscribe(TransactionLogger::TransactionType type, Subscriber callback) {
+        lock_guard<mutex> guard(subscriberMutex);
+        subscribers.push_back({false, type, callback});
+    }
+
+    // Subscribe to every transaction type
+    void subscribeAll(Subscriber callback) {
+        lock_guard<mutex> guard(subscriberMutex);
+        subscribers.push_back({true, TransactionLogger::USER_REGISTRATION, callback});
+    }
+
+    // Start the dispatch worker
+    void start() {
+        lock_guard<mutex> lock(queueMutex);
+        if (worker.joinable()) return;
+        stopping = false;
+        running = true;
+        worker = thread(&EventBus::run, this);
+    }
+
+    // Queue an event, waiting while the queue is full. Without a running
+    // worker (not started, or already stopped) it is dispatched right here.
+    void publish(const SystemEvent& event) {
+        if (deferred) {
+            deferred->push_back(event);
+            return;
+        }
+        unique_lock<mutex> lock(queueMutex);
+        notFull.wait(lock, [this] { return pending.size() < MAX_PENDING || !running; });
+        if (!running) {
+            lock.unlock();
+            dispatch(event);
+            return;
+        }
+        pending.push_back(event);
+        lock.unlock();
+        notEmpty.notify_one();
+    }
+
+    // Wait until every queued event has been dispatched
+    void flush() {
+        unique_lock<mutex> lock(queueMutex);
+        if (!worker.joinable()) return;
+        drained.wait(lock, [this] { return pending.empty() && !dispatching; });
+    }
+
+    // Dispatch what is left and stop the worker
+    void stop() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            if (!worker.joinable()) return;
+            stopping = true;
+        }
+        notEmpty.notify_all();
+        worker.join();
+        notFull.notify_all();   // Waiting publishers now dispatch inline
+    }
+};
+
+thread_local vector<SystemEvent>* EventBus::deferred = nullptr;
+
+EventBus eventBus;
+
+// Per-user notifications waiting to be shown at the terminal
+class NotificationCenter {
+private:
+    mutex mtx;
+    unordered_map<string, vector<string>> pending;
+
+public:
+    void post(const string& username, const string& message) {
+        lock_guard<mutex> guard(mtx);
+        pending[username].push_back(message);
+    }
+
+    // Take all waiting notifications for a user
+    vector<string> take(const string& username) {
+        lock_guard<mutex> guard(mtx);
+        vector<string> messages;
+        auto it = pending.find(username);
+        if (it != pending.end()) {
+            messages.swap(it->second);
+            pending.erase(it);
+        }
+        return messages;
+    }
+};
+
+NotificationCenter notifications;
+
+// Lock-free token bucket
+// Token count (in thousandths) and last refill time share one 64-bit word,
+// so acquiring is a single compare-and-swap with no lock. The refill time
+// only advances by the time that has been turned into whole milli-tokens,
+// so slow rates don't lose their fractional remainder.
+class TokenBucket {
+private:
+    static const int TOKEN_BITS = 24;
+    static const unsigned long long TOKEN_MASK = (1ULL << TOKEN_BITS) - 1;
+
+    atomic<unsigned long long> state;   // [refill time ms : 40][milli-tokens : 24]
+    long long capacityMilli;
+    double refillMilliPerMs;            // Equal to the refill rate in tokens per second
+
+    static long long nowMs() {
+        return Clock::steadyMs();
+    }
+
+    static unsigned long long pack(long long timeMs, long long milliTokens) {
+        return (static_cast<unsigned long long>(timeMs) << TOKEN_BITS) |
+            static_cast<unsigned long long>(milliTokens);
+    }
+
+public:
+    // Capacity is capped at 16000 tokens by the packed layout
+    TokenBucket(double capacity, double refillPerSecond)
+        : capacityMilli(min(static_cast<long long>(capacity * 1000), static_cast<long long>(TOKEN_MASK))),
+        refillMilliPerMs(refillPerSecond) {
+        state.store(pack(nowMs(), capacityMilli));
+    }
+
+    // Take one token, returns false if the bucket is empty
+    bool tryAcquire() {
+        long long now = nowMs();
+        unsigned long long current = state.load(memory_order_relaxed);
+        while (true) {
+            long long lastMs = static_cast<long long>(current >> TOKEN_BITS);
+            long long tokens = static_cast<long long>(current & TOKEN_MASK);
+            long long elapsed = max(0LL, now - lastMs);
+            long long gained = static_cast<long long>(elapsed * refillMilliPerMs);
+            long long refilledMs = lastMs;
+            if (tokens + gained >= capacityMilli) {
+                tokens = capacityMilli;
+                refilledMs = max(now, lastMs);
+            } else if (gained > 0) {
+                tokens += gained;
+                refilledMs = lastMs + static_cast<long long>(gained / refillMilliPerMs);
+            }
+            if (tokens < 1000) {
+                return false;
+            }
+            unsigned long long next = pack(refilledMs, tokens - 1000);
+            if (state.compare_exchange_weak(current, next, memory_order_acq_rel)) {
+                return true;
+            }
+        }
+    }
+
+    // True when the bucket has refilled completely (entry can be dropped)
+    bool isFull() const {
+        unsigned long long current = state.load(memory_order_relaxed);
+        long long lastMs = static_cast<long long>(current >> TOKEN_BITS);
+        long long tokens = static_cast<long long>(current & TOKEN_MASK);
+        return tokens + static_cast<long long>(max(0LL, nowMs() - lastMs) * refillMilliPerMs) >= capacityMilli;
+    }
+};
+
+// Login throttling
+// A global bucket caps the total login rate and a per-username bucket caps
+// attempts against one account. Only existing accounts get their own
+// bucket; unknown usernames share one, so guessing names can't grow the
+// table. Failed attempts are only counted in memory
+// and written to the transaction log in aggregated batches, so a burst of
+// bad passwords does not turn into a burst of file writes.
+class LoginThrottle {
+public:
+    static const size_t SHARD_COUNT = 16;
+    static const size_t EXPIRY_CHECK_SIZE = 1024;   // Sweep a shard when it grows past this
+    static const long long FAILURE_FLUSH_SECONDS = 60;
+
+private:
+    struct Entry {
+        TokenBucket bucket;
+        atomic<long long> failures{0};
+        Entry() : bucket(5, 1.0 / 30) {}   // 5 attempts, then one every 30 seconds
+    };
+
+    struct Shard {
+        mutex mtx;      // Guards the table only; buckets are lock-free
+        unordered_map<string, shared_ptr<Entry>> entries;
+    };
+
+    TokenBucket globalBucket{200, 50};  // Whole-system burst and sustained rate
+    TokenBucket unknownUserBucket{20, 1};   // Shared by every unknown username
+    Shard shards[SHARD_COUNT];
+    atomic<long long> unknownUserFailures{0};
+    atomic<long long> lastFlush{static_cast<long long>(Clock::now())};
+    string unknownUserAccount = "admin";    // Log owner for unknown-username failures
+
+    Shard& shardFor(const string& username) {
+        return shards[hash<string>{}(username) % SHARD_COUNT];
+    }
+
+    // Drop entries that are idle: bucket refilled and no failures pending
+    static void expireIdle(Shard& shard) {
+        for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+            if (it->second->bucket.isFull() && it->second->failures.load() == 0) {
+                it = shard.entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    shared_ptr<Entry> entryFor(const string& username) {
+        Shard& shard = shardFor(username);
+        lock_guard<mutex> guard(shard.mtx);
+        auto it = shard.entries.find(username);
+        if (it != shard.entries.end()) {
+            return it->second;
+        }
+        if (shard.entries.size() >= EXPIRY_CHECK_SIZE) {
+            expireIdle(shard);
+        }
+        auto entry = make_shared<Entry>();
+        shard.entries.emplace(username, entry);
+        return entry;
+    }
+
+public:
+    // Set the account whose log receives unknown-username failures
+    void setUnknownUserAccount(const string& username) {
+        unknownUserAccount = username;
+    }
+
+    // Check whether a login attempt for this username may proceed
+    bool allow(const string& username, bool knownUser) {
+        if (!globalBucket.tryAcquire()) {
+            return false;
+        }
+        if (!knownUser) {
+            return unknownUserBucket.tryAcquire();
+        }
+        return entryFor(username)->bucket.tryAcquire();
+    }
+
+    // Count a failed attempt; unknown usernames are counted together
+    void recordFailure(const string& username, bool knownUser) {
+        if (knownUser) {
+            entryFor(username)->failures.fetch_add(1, memory_order_relaxed);
+        } else {
+            unknownUserFailures.fetch_add(1, memory_order_relaxed);
+        }
+
+        long long now = Clock::now();
+        long long last = lastFlush.load();
+        if (now - last >= FAILURE_FLUSH_SECONDS && lastFlush.compare_exchange_strong(last, now)) {
+            flushFailures();
+        }
+    }
+
+    // Log one aggregated entry per user with pending failures
+    void flushFailures() {
+        for (auto& shard : shards) {
+            vector<pair<string, long long>> pending;
+            {
+                lock_guard<mutex> guard(shard.mtx);
+                for (auto& entry : shard.entries) {
+                    long long count = entry.second->failures.exchange(0);
+                    if (count > 0) {
+                        pending.emplace_back(entry.first, count);
+                    }
+                }
+            }
+            for (const auto& item : pending) {
+                eventBus.publish(SystemEvent(
+                    TransactionLogger::LOGIN_FAILURE,
+                    item.first,
+                    to_string(item.second) + " failed login attempts"
+                ));
+            }
+        }
+
+        long long unknown = unknownUserFailures.exchange(0);
+        if (unknown > 0) {
+            eventBus.publish(SystemEvent(
+                TransactionLogger::LOGIN_FAILURE,
+                unknownUserAccount,
+                to_string(unknown) + " failed login attempts for unknown usernames"
+            ));
+        }
+    }
+};
+
+LoginThrottle loginThrottle;
+
+
+// Transaction search index
+// Inverted index over everything the transaction logger writes: postings
+// by type, user and lock box id, an ordered amount index, and entries kept
+// in time order so a time range is a binary search. New entries are added
+// from the event bus as they are logged; older ones are read back from the
+// log files by a background thread at startup.
+class TransactionIndex {
+public:
+    struct Entry {
+        time_t time = 0;
+        TransactionLogger::TransactionType type = TransactionLogger::USER_REGISTRATION;
+        string username;
+        long long amountCents = 0;
+        long long lockBoxId = -1;
+        string details;
+
+        static constexpr auto recordFields() {
+            return make_tuple(&Entry::time, &Entry::type, &Entry::username, &Entry::amountCents,
+                              &Entry::lockBoxId, &Entry::details);
+        }
+    };
+
+    // Unset filters match everything
+    struct Query {
+        int type = -1;
+        string username;
+        long long lockBoxId = -1;
+        long long minCents = -1;
+        long long maxCents = -1;
+        time_t from = 0;
+        time_t to = 0;          // Exclusive, 0 for no limit
+
+        static constexpr auto recordFields() {
+            return make_tuple(&Query::type, &Query::username, &Query::lockBoxId,
+                              &Query::minCents, &Query::maxCents, &Query::from, &Query::to);
+        }
+
+        bool matches(const Entry& entry) const {
+            return (type < 0 || entry.type == type) &&
+                (username.empty() || entry.username == username) &&
+                (lockBoxId < 0 || entry.lockBoxId == lockBoxId) &&
+                (minCents < 0 || entry.amountCents >= minCents) &&
+                (maxCents < 0 || entry.amountCents <= maxCents) &&
+                entry.time >= from && (to == 0 || entry.time < to);
+        }
+    };
+
+private:
+    using Postings = vector<uint32_t>;     // Entry positions, ascending
+
+    mutable mutex mtx;
+    vector<Entry> entries;                  // In time order
+    vector<Postings> byType;
+    unordered_map<string, Postings> byUser;
+    unordered_map<long long, Postings> byLockBox;
+    map<long long, Postings> byAmount;      // Amount in cents
+    bool historyLoaded = false;
+    atomic<bool> stopping{false};
+    thread loader;
+
+    // Add the postings of entries[position] (mtx held)
+    void post(uint32_t position) {
+        const Entry& entry = entries[position];
+        if (byType.size() <= static_cast<size_t>(entry.type)) byType.resize(entry.type + 1);
+        byType[entry.type].push_back(position);
+        byUser[entry.username].push_back(position);
+        if (entry.lockBoxId >= 0) byLockBox[entry.lockBoxId].push_back(position);
+        byAmount[entry.amountCents].push_back(position);
+    }
+
+    // Rebuild every posting list after positions moved (mtx held)
+    void reindex() {
+        byType.clear();
+        byUser.clear();
+        byLockBox.clear();
+        byAmount.clear();
+        for (size_t i = 0; i < entries.size(); i++) {
+            post(static_cast<uint32_t>(i));
+        }
+    }
+
+    // Local start of the hour of the last parsed log line. Lines come in
+    // time order, so mktime runs about once per hour of history.
+    struct HourCache {
+        int year = -1, month = 0, day = 0, hour = 0;
+        time_t start = 0;
+    };
+
+    // Positions of the first entry at or after time t
+    size_t lowerBound(time_t t) const {
+        return static_cast<size_t>(lower_bound(entries.begin(), entries.end(), t,
+            [](const Entry& entry, time_t value) { return entry.time < value; }) - entries.begin());
+    }
+
+    // Parse one transaction_log.txt line; older lines have no lock box
+    // id field, so the "#id" in their details is used instead
+    static bool parseLogLine(const string& line, Entry& entry, HourCache& cache) {
+        vector<string> tokens = splitRecord(line);
+        if (tokens.size() < 4) return false;
+        int year, month, day, hour, minute, second;
+        if (sscanf(tokens[0].c_str(), "%d-%d-%d %d:%d:%d", &year, &month, &day,
+                   &hour, &minute, &second) != 6) {
+            return false;
+        }
+        if (year != cache.year || month != cache.month || day != cache.day || hour != cache.hour) {
+            tm local = {};
+            local.tm_year = year - 1900;
+            local.tm_mon = month - 1;
+            local.tm_mday = day;
+            local.tm_hour = hour;
+            local.tm_isdst = -1;
+            cache = {year, month, day, hour, mktime(&local)};
+        }
+        entry.time = cache.start + minute * 60 + second;
+
+        double amount;
+        if (!TransactionLogger::parseTransactionType(tokens[1], entry.type) ||
+            !RecordCodec::decodeField(tokens[3], amount)) {
+            return false;
+        }
+        RecordCodec::decodeField(tokens[2], entry.username);
+        entry.amountCents = llround(amount * 100.0);
+        entry.details.clear();
+        if (tokens.size() > 4) RecordCodec::decodeField(tokens[4], entry.details);
+        entry.lockBoxId = -1;
+        if (tokens.size() > 5) {
+            RecordCodec::decodeField(tokens[5], entry.lockBoxId);
+        } else {
+            size_t hash = entry.details.find('#');
+            if (hash != string::npos) entry.lockBoxId = atoll(entry.details.c_str() + hash + 1);
+        }
+        return true;
+    }
+
+    // Read the logs up to the sizes they had when indexing started, then
+    // merge them by time with the entries logged since (history first on ties)
+    void loadFiles(vector<pair<string, uintmax_t>> files) {
+        vector<Entry> history;
+        HourCache cache;
+        for (const auto& file : files) {
+            ifstream log(file.first);
+            string line;
+            uintmax_t consumed = 0;
+            while (consumed < file.second && getline(log, line) && !stopping) {
+                consumed += line.size() + 1;
+                Entry entry;
+                if (parseLogLine(line, entry, cache)) history.push_back(move(entry));
+            }
+        }
+        auto byTime = [](const Entry& a, const Entry& b) { return a.time < b.time; };
+        stable_sort(history.begin(), history.end(), byTime);
+
+        lock_guard<mutex> guard(mtx);
+        vector<Entry> merged;
+        merged.reserve(history.size() + entries.size());
+        merge(make_move_iterator(history.begin()), make_move_iterator(history.end()),
+              make_move_iterator(entries.begin()), make_move_iterator(entries.end()),
+              back_inserter(merged), byTime);
+        entries.swap(merged);
+        reindex();
+        historyLoaded = true;
+    }
+
+public:
+    ~TransactionIndex() { stop(); }
+
+    // Start indexing the existing logs. Call before the event bus starts,
+    // so every entry is either in the files read here or added live.
+    void loadHistory() {
+        vector<pair<string, uintmax_t>> files;
+        error_code ec;
+        for (const auto& dir : filesystem::directory_iterator(RECEIPTS_DIR, ec)) {
+            filesystem::path log = dir.path() / "transaction_log.txt";
+            uintmax_t size = filesystem::file_size(log, ec);
+            if (!ec && size > 0) files.emplace_back(log.string(), size);
+        }
+        stopping = false;
+        loader = thread(&TransactionIndex::loadFiles, this, move(files));
+    }
+
+    void stop() {
+        stopping = true;
+        if (loader.joinable()) loader.join();
+    }
+
+    // Index one logged transaction
+    void add(const SystemEvent& event) {
+        Entry entry;
+        entry.time = Clock::now();
+        entry.type = event.type;
+        entry.username = event.username;
+        entry.amountCents = llround(event.amount * 100.0);
+        entry.lockBoxId = event.lockBoxId;
+        entry.details = event.details;
+
+        lock_guard<mutex> guard(mtx);
+        if (entries.empty() || entries.back().time <= entry.time) {
+            entries.push_back(move(entry));
+            post(static_cast<uint32_t>(entries.size() - 1));
+            return;
+        }
+        // The clock stepped back: keep the entry's own time and place it
+        // after everything at or before it. Rare, so the postings are rebuilt.
+        auto position = upper_bound(entries.begin(), entries.end(), entry.time,
+            [](time_t value, const Entry& existing) { return value < existing.time; });
+        entries.insert(position, move(entry));
+        reindex();
+    }
+
+    // Matching entries in time order. Scans the shortest posting list
+    // that applies, clipped to the time range, and checks the rest.
+    vector<Entry> search(const Query& query) const {
+        lock_guard<mutex> guard(mtx);
+        uint32_t first = static_cast<uint32_t>(lowerBound(query.from));
+        uint32_t last = static_cast<uint32_t>(query.to == 0 ? entries.size() : lowerBound(query.to));
+        static const Postings none;
+
+        const Postings* best = nullptr;
+        auto consider = [&](const Postings* postings) {
+            if (!best || postings->size() < best->size()) best = postings;
+        };
+        if (query.type >= 0) {
+            consider(static_cast<size_t>(query.type) < byType.size() ? &byType[query.type] : &none);
+        }
+        if (!query.username.empty()) {
+            auto it = byUser.find(query.username);
+            consider(it != byUser.end() ? &it->second : &none);
+        }
+        if (query.lockBoxId >= 0) {
+            auto it = byLockBox.find(query.lockBoxId);
+            consider(it != byLockBox.end() ? &it->second : &none);
+        }
+
+        // Only an amount filter: collect the positions in the amount range
+        Postings inRange;
+        if (!best && (query.minCents >= 0 || query.maxCents >= 0)) {
+            auto begin = query.minCents >= 0 ? byAmount.lower_bound(query.minCents) : byAmount.begin();
+            auto end = query.maxCents >= 0 ? byAmount.upper_bound(query.maxCents) : byAmount.end();
+            for (auto it = begin; it != end; ++it) {
+                inRange.insert(inRange.end(), it->second.begin(), it->second.end());
+            }
+            sort(inRange.begin(), inRange.end());
+            best = &inRange;
+        }
+
+        vector<Entry> results;
+        if (best) {
+            for (auto it = lower_bound(best->begin(), best->end(), first);
+                 it != best->end() && *it < last; ++it) {
+                if (query.matches(entries[*it])) results.push_back(entries[*it]);
+            }
+        } else {
+            for (uint32_t i = first; i < last; i++) {
+                if (query.matches(entries[i])) results.push_back(entries[i]);
+            }
+        }
+        return results;
+    }
+
+    bool isHistoryLoaded() const {
+        lock_guard<mutex> guard(mtx);
+        return historyLoaded;
+    }
+
+    size_t size() const {
+        lock_guard<mutex> guard(mtx);
+        return entries.size();
+    }
+};
+
+TransactionIndex transactionIndex;
+
+// Register the default subscribers: transaction log, receipts and notifications
+void registerEventSubscribers() {
+    eventBus.subscribeAll([](const SystemEvent& event) {
+        TransactionLogger::logTransaction(event.type, event.username, event.details,
+                                          event.amount, event.lockBoxId);
+        transactionIndex.add(event);
+    });
+
+    auto receiptWriter = [](const SystemEvent& event) {
+        string username = event.username;
+        TransactionLogger::generateReceipt(
+            event.type, event.username, event.details, event.amount, event.lockBoxId,
+            [username](const string& receiptFile) {
+                notifications.post(username, "Receipt generated: " + receiptFile);
+            });
+    };
+    eventBus.subscribe(TransactionLogger::CREATE_LOCKBOX, receiptWriter);
+    eventBus.subscribe(TransactionLogger::RELEASE_LOCKBOX, receiptWriter);
+    eventBus.subscribe(TransactionLogger::CREATE_SCHEDULE, receiptWriter);
+
+    eventBus.subscribe(TransactionLogger::RELEASE_LOCKBOX, [](const SystemEvent& event) {
+        stringstream message;
+        message << "*** NOTIFICATION: " << event.details
+            << "! $" << fixed << setprecision(2)
+            << event.amount << " has been returned to your balance. ***";
+        notifications.post(event.username, message.str());
+    });
+}
+
+// Print and clear a user's waiting notifications
+void showNotifications(const string& username) {
+    for (const auto& message : notifications.take(username)) {
+        cout << "\n" << message << "\n";
+    }
+}
+
+// Immutable point-in-time view of a user, used by admin reports
+struct UserRecord {
+    string username;
+    double balance;
+    bool active;
+    size_t lockBoxCount;
+    string registrationDate;
+
+    // Format this user as one listing row
+    bool render(ConsoleRenderer& out) const {
+        out.text("Username: ").text(username)
+            .text(" | Balance: $").money(balance)
+            .text(" | Status: ").text(active ? "Active" : "Inactive")
+            .text(" | Lock Boxes: ").integer(static_cast<long long>(lockBoxCount))
+            .text(" | Registration Date: ").text(registrationDate);
+        return out.endRow();
+    }
+
+    void displayDetails() const {
+        ConsoleRenderer out;
+        render(out);
+    }
+
+    // Fields of the line format used to gather listings from partitions
+    static constexpr auto recordFields() {
+        return make_tuple(&UserRecord::username, &UserRecord::balance, &UserRecord::active,
+                          &UserRecord::lockBoxCount, &UserRecord::registrationDate);
+    }
+
+    static MemoryAccount& memoryAccount() { return memoryAccounts.users; }
+
+    void saveToFile(ostream& file) const {
+        RecordCodec::write(file, *this);
+    }
+
+    static shared_ptr<const UserRecord> parseRecord(const string& line) {
+        return RecordCodec::decode<UserRecord>(line);
+    }
+};
+
+// Consistent read-only view of the system state
+// Holds immutable records only, so reports can iterate it for as long as
+// they like without blocking writers. Old versions are freed when the last
+// snapshot referencing them goes away.
+// Release log as it was at one point in time. Sealed chunks are shared
+// with the live log and only each shard's open chunk is copied; iterating
+// merges the shards by release sequence without building a combined copy.
+class ReleaseLogView {
+public:
+    using Entry = pair<unsigned long long, shared_ptr<ReleaseEvent>>;
+    using Chunk = pmr::vector<Entry>;
+
+private:
+    vector<vector<shared_ptr<const Chunk>>> shards;    // Each shard's chunks, in order
+    size_t entryCount = 0;
+
+public:
+    void addShard(vector<shared_ptr<const Chunk>> chunks) {
+        for (const auto& chunk : chunks) {
+            entryCount += chunk->size();
+        }
+        shards.push_back(move(chunks));
+    }
+
+    size_t size() const { return entryCount; }
+
+    // Call visit(event) in release order until it returns false
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        struct Cursor { size_t chunk = 0; size_t entry = 0; };
+        vector<Cursor> cursors(shards.size());
+        while (true) {
+            const Entry* next = nullptr;
+            size_t from = 0;
+            for (size_t i = 0; i < shards.size(); i++) {
+                const Cursor& cursor = cursors[i];
+                if (cursor.chunk >= shards[i].size()) continue;
+                const Entry& entry = (*shards[i][cursor.chunk])[cursor.entry];
+                if (!next || entry.first < next->first) {
+                    next = &entry;
+                    from = i;
+                }
+            }
+            if (!next || !visit(next->second)) return;
+            Cursor& cursor = cursors[from];
+            if (++cursor.entry == shards[from][cursor.chunk]->size()) {
+                cursor.chunk++;
+                cursor.entry = 0;
+            }
+        }
+    }
+
+    vector<shared_ptr<ReleaseEvent>> toVector() const {
+        vector<shared_ptr<ReleaseEvent>> events;
+        events.reserve(entryCount);
+        forEach([&events](const shared_ptr<ReleaseEvent>& event) {
+            events.push_back(event);
+            return true;
+        });
+        return events;
+    }
+};
+
+struct StateSnapshot {
+    vector<shared_ptr<const UserRecord>> users;         // Sorted by username
+    ReleaseLogView releaseLog;
+};
+
+// Sharded system state
+// Users are partitioned by username hash. Each shard has its own lock and
+// its own segment of the release log, so independent users can be mutated
+// in parallel without contending on a single global lock.
+class SystemState {
+public:
+    static const size_t SHARD_COUNT = 16;
+    static const size_t LOG_CHUNK_SIZE = 1024;
+
+private:
+    using LogChunk = ReleaseLogView::Chunk;
+
+    struct UserEntry {
+        shared_ptr<User> user;
+        shared_ptr<const UserRecord> record;   // Latest published version
+    };
+
+    struct Shard {
+        mutable mutex userMutex;    // Held while mutating a user in this shard
+        mutable mutex indexMutex;   // Guards the user index, held only briefly
+        mutable mutex logMutex;     // Guards this shard's release log segment
+        pmr::unordered_map<string, UserEntry> users{&memoryAccounts.users};
+        // Release log segment: full chunks are sealed and never change again,
+        // so snapshots share them instead of copying
+        vector<shared_ptr<const LogChunk>> sealedChunks;
+        LogChunk openChunk{&memoryAccounts.releaseLog};
+    };
+
+    Shard shards[SHARD_COUNT];
+    atomic<unsigned long long> releaseSequence{0}; // Keeps merged logs in global order
+
+    Shard& shardFor(const string& username) {
+        return shards[hash<string>{}(username) % SHARD_COUNT];
+    }
+
+    const Shard& shardFor(const string& username) const {
+        return shards[hash<string>{}(username) % SHARD_COUNT];
+    }
+
+    // Add a shard's release log segment to a view (logMutex held)
+    static void viewShardLog(const Shard& shard, ReleaseLogView& view) {
+        vector<shared_ptr<const LogChunk>> chunks = shard.sealedChunks;
+        if (!shard.openChunk.empty()) {
+            chunks.push_back(make_shared<const LogChunk>(shard.openChunk));
+        }
+        view.addShard(move(chunks));
+    }
+
+    // Append to a shard's release log segment (logMutex held). The sequence
+    // is taken under the lock so each segment stays in sequence order.
+    void appendToShardLog(Shard& shard, shared_ptr<ReleaseEvent> event) {
+        shard.openChunk.emplace_back(releaseSequence.fetch_add(1), move(event));
+        if (shard.openChunk.size() >= LOG_CHUNK_SIZE) {
+            shard.sealedChunks.push_back(allocate_shared<LogChunk>(
+                pmr::polymorphic_allocator<LogChunk>(&memoryAccounts.releaseLog), move(shard.openChunk)));
+            shard.openChunk.clear();    // Keeps its memory account
+        }
+    }
+
+public:
+    // Lock that must be held while mutating a user (lock boxes, balance, status)
+    mutex& getUserMutex(const string& username) {
+        return shardFor(username).userMutex;
+    }
+
+    // Find a user by username, nullptr if not registered
+    shared_ptr<User> findUser(const string& username) const {
+        const Shard& shard = shardFor(username);
+        lock_guard<mutex> guard(shard.indexMutex);
+        auto it = shard.users.find(username);
+        return it != shard.users.end() ? it->second.user : nullptr;
+    }
+
+    // Latest published record of a user, nullptr if not registered
+    shared_ptr<const UserRecord> findUserRecord(const string& username) const {
+        const Shard& shard = shardFor(username);
+        lock_guard<mutex> guard(shard.indexMutex);
+        auto it = shard.users.find(username);
+        return it != shard.users.end() ? it->second.record : nullptr;
+    }
+
+    // Add a user with its initial record, returns false if the username is already taken
+    bool addUser(const string& username, shared_ptr<User> user, shared_ptr<const UserRecord> record) {
+        Shard& shard = shardFor(username);
+        lock_guard<mutex> guard(shard.indexMutex);
+        return shard.users.emplace(username, UserEntry{user, record}).second;
+    }
+
+    // Replace a user's published record after a mutation
+    void publishUserRecord(const string& username, shared_ptr<const UserRecord> record) {
+        Shard& shard = shardFor(username);
+        lock_guard<mutex> guard(shard.indexMutex);
+        auto it = shard.users.find(username);
+        if (it != shard.users.end()) {
+            it->second.record = record;
+        }
+    }
+
+    // All users, sorted by username
+    vector<shared_ptr<User>> getAllUsers() const {
+        vector<pair<string, shared_ptr<User>>> collected;
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard.indexMutex);
+            for (const auto& entry : shard.users) {
+                collected.emplace_back(entry.first, entry.second.user);
+            }
+        }
+        sort(collected.begin(), collected.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        vector<shared_ptr<User>> result;
+        result.reserve(collected.size());
+        for (auto& entry : collected) {
+            result.push_back(entry.second);
+        }
+        return result;
+    }
+
+    size_t getUserCount() const {
+        size_t count = 0;
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard.indexMutex);
+            count += shard.users.size();
+        }
+        return count;
+    }
+
+    void clearUsers() {
+        for (auto& shard : shards) {
+            lock_guard<mutex> guard(shard.indexMutex);
+            shard.users.clear();
+        }
+    }
+
+    // Append a release event to the owner's shard
+    void appendReleaseEvent(const string& username, shared_ptr<ReleaseEvent> event) {
+        Shard& shard = shardFor(username);
+        lock_guard<mutex> guard(shard.logMutex);
+        appendToShardLog(shard, move(event));
+    }
+
+    // Publish a user's new record together with the release events that
+    // produced it, so a snapshot sees both or neither
+    void publishRelease(const string& username, shared_ptr<const UserRecord> record,
+                        vector<shared_ptr<ReleaseEvent>> events) {
+        Shard& shard = shardFor(username);
+        lock_guard<mutex> indexGuard(shard.indexMutex);
+        lock_guard<mutex> logGuard(shard.logMutex);
+        auto it = shard.users.find(username);
+        if (it != shard.users.end()) {
+            it->second.record = move(record);
+        }
+        for (auto& event : events) {
+            appendToShardLog(shard, move(event));
+        }
+    }
+
+    // Release log across all shards, in release order
+    vector<shared_ptr<ReleaseEvent>> getReleaseLog() const {
+        ReleaseLogView view;
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard.logMutex);
+            viewShardLog(shard, view);
+        }
+        return view.toVector();
+    }
+
+    void clearReleaseLog() {
+        for (auto& shard : shards) {
+            lock_guard<mutex> guard(shard.logMutex);
+            shard.sealedChunks.clear();
+            shard.openChunk.clear();
+        }
+    }
+
+    // Take a point-in-time snapshot for reports. Every shard's index and
+    // log locks are held together (in shard order, index before log, the
+    // same order publishRelease uses) while pointers are copied, so the cut
+    // is consistent across users and releases. User mutexes aren't taken.
+    StateSnapshot takeSnapshot() const {
+        StateSnapshot snapshot;
+        vector<unique_lock<mutex>> locks;
+        locks.reserve(SHARD_COUNT * 2);
+        for (const auto& shard : shards) {
+            locks.emplace_back(shard.indexMutex);
+            locks.emplace_back(shard.logMutex);
+        }
+        for (const auto& shard : shards) {
+            for (const auto& entry : shard.users) {
+                if (entry.second.record) {
+                    snapshot.users.push_back(entry.second.record);
+                }
+            }
+            viewShardLog(shard, snapshot.releaseLog);
+        }
+        locks.clear();
+
+        sort(snapshot.users.begin(), snapshot.users.end(),
+            [](const auto& a, const auto& b) { return a->username < b->username; });
+        return snapshot;
+    }
+};
+
+SystemState systemState;
+
+
+// Time-bucketed index of upcoming releases
+// Maps each unlock-time bucket to the lock boxes and schedule installments
+// that fall due in it, so release processing finds due items without
+// scanning every box. Updated on create and release, and saved with each
+// checkpoint. Loading it only replaces a rebuild from the boxes: they are
+// still read in full at startup, and nothing is released before the
+// loaded checkpoint has been verified.
+class DueIndex {
+public:
+    static const time_t BUCKET_SECONDS = 60;
+
+    struct Entry {
+        long long id;       // Lock box or schedule id
+        time_t due;
+        string username;
+    };
+
+private:
+    mutable mutex mtx;
+    map<time_t, vector<Entry>> buckets;     // Keyed by bucket start
+    size_t entryCount = 0;
+
+    static time_t bucketOf(time_t due) {
+        time_t offset = due % BUCKET_SECONDS;
+        return due - (offset < 0 ? offset + BUCKET_SECONDS : offset);
+    }
+
+public:
+    void add(long long id, time_t due, const string& username) {
+        lock_guard<mutex> guard(mtx);
+        buckets[bucketOf(due)].push_back(Entry{id, due, username});
+        entryCount++;
+    }
+
+    void remove(long long id, time_t due) {
+        lock_guard<mutex> guard(mtx);
+        auto bucket = buckets.find(bucketOf(due));
+        if (bucket == buckets.end()) return;
+        auto& entries = bucket->second;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].id == id) {
+                entries[i] = move(entries.back());
+                entries.pop_back();
+                entryCount--;
+                break;
+            }
+        }
+        if (entries.empty()) buckets.erase(bucket);
+    }
+
+    // Remove and return every entry due at or before now
+    vector<Entry> takeDue(time_t now) {
+        lock_guard<mutex> guard(mtx);
+        vector<Entry> due;
+        auto bucket = buckets.begin();
+        while (bucket != buckets.end() && bucket->first <= now) {
+            auto& entries = bucket->second;
+            for (size_t i = 0; i < entries.size();) {
+                if (entries[i].due <= now) {
+                    due.push_back(move(entries[i]));
+                    entries[i] = move(entries.back());
+                    entries.pop_back();
+                    entryCount--;
+                } else {
+                    i++;
+                }
+            }
+            bucket = entries.empty() ? buckets.erase(bucket) : next(bucket);
+        }
+        return due;
+    }
+
+    vector<Entry> getEntries() const {
+        lock_guard<mutex> guard(mtx);
+        vector<Entry> entries;
+        entries.reserve(entryCount);
+        for (const auto& bucket : buckets) {
+            entries.insert(entries.end(), bucket.second.begin(), bucket.second.end());
+        }
+        return entries;
+    }
+
+    size_t size() const {
+        lock_guard<mutex> guard(mtx);
+        return entryCount;
+    }
+
+    void clear() {
+        lock_guard<mutex> guard(mtx);
+        buckets.clear();
+        entryCount = 0;
+    }
+};
+
+DueIndex dueIndex;
+
+
+// Append-only balance ledger of one user
+// Every balance change is recorded as a typed delta in cents. The running
+// balance is kept every CHECKPOINT_INTERVAL entries, so the balance at any
+// time is a binary search plus at most CHECKPOINT_INTERVAL additions.
+class BalanceLedger {
+public:
+    static const size_t CHECKPOINT_INTERVAL = 64;
+
+    enum Kind {
+        REGISTRATION,
+        LOCK,
+        RELEASE,
+        OPENING         // Balance carried over from before the ledger, or a repair
+    };
+
+    struct Entry {
+        time_t time;
+        Kind kind;
+        long long deltaCents;
+        long long refId;        // Lock box or schedule id, -1 if none
+    };
+
+    // Entries in [first, last) of a period with the balances around them
+    struct Statement {
+        long long openingCents;
+        long long closingCents;
+        size_t first;
+        size_t last;
+    };
+
+private:
+    vector<Entry> entries;              // In time order
+    vector<long long> checkpoints;      // Balance before entries[k * CHECKPOINT_INTERVAL]
+    long long balanceCents = 0;
+
+    // Number of entries at or before time t
+    size_t countUpTo(time_t t) const {
+        return static_cast<size_t>(upper_bound(entries.begin(), entries.end(), t,
+            [](time_t value, const Entry& entry) { return value < entry.time; }) - entries.begin());
+    }
+
+    // Balance after the first count entries
+    long long balanceAfter(size_t count) const {
+        if (count == entries.size()) return balanceCents;
+        size_t checkpoint = count / CHECKPOINT_INTERVAL;
+        long long balance = checkpoints[checkpoint];
+        for (size_t i = checkpoint * CHECKPOINT_INTERVAL; i < count; i++) {
+            balance += entries[i].deltaCents;
+        }
+        return balance;
+    }
+
+public:
+    static long long toCents(double amount) { return llround(amount * 100.0); }
+
+    void record(time_t time, Kind kind, long long deltaCents, long long refId = -1) {
+        if (entries.size() % CHECKPOINT_INTERVAL == 0) {
+            checkpoints.push_back(balanceCents);
+        }
+        // Keep the entries sorted even if the clock steps back
+        if (!entries.empty() && time < entries.back().time) {
+            time = entries.back().time;
+        }
+        entries.push_back(Entry{time, kind, deltaCents, refId});
+        balanceCents += deltaCents;
+    }
+
+    // Place an entry at its own time, ahead of entries at the same time.
+    // Rebuilds the checkpoints, so it is meant for repairs only.
+    void insert(const Entry& entry) {
+        auto position = lower_bound(entries.begin(), entries.end(), entry.time,
+            [](const Entry& existing, time_t t) { return existing.time < t; });
+        entries.insert(position, entry);
+        checkpoints.clear();
+        balanceCents = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i % CHECKPOINT_INTERVAL == 0) checkpoints.push_back(balanceCents);
+            balanceCents += entries[i].deltaCents;
+        }
+    }
+
+    // Balance including every entry at or before time t
+    long long balanceAt(time_t t) const {
+        return balanceAfter(countUpTo(t));
+    }
+
+    // Entries and balances for the period [from, to)
+    Statement statement(time_t from, time_t to) const {
+        size_t first = countUpTo(from - 1);
+        size_t last = countUpTo(to - 1);
+        return Statement{balanceAfter(first), balanceAfter(last), first, last};
+    }
+
+    long long getBalanceCents() const { return balanceCents; }
+    const vector<Entry>& getEntries() const { return entries; }
+
+    static const char* kindName(Kind kind) {
+        switch (kind) {
+            case REGISTRATION: return "Registration";
+            case LOCK: return "Locked";
+            case RELEASE: return "Released";
+            case OPENING: return "Opening balance";
+            default: return "Unknown";
+        }
+    }
+};
+
+
+// One ledger entry as stored in the ledger file
+struct LedgerRecord {
+    string username;
+    time_t time;
+    BalanceLedger::Kind kind;
+    long long deltaCents;
+    long long refId;
+
+    static constexpr auto recordFields() {
+        return make_tuple(&LedgerRecord::username, &LedgerRecord::time, &LedgerRecord::kind,
+                          &LedgerRecord::deltaCents, &LedgerRecord::refId);
+    }
+
+    // Only read during a load, then folded into the users' ledgers
+    static MemoryAccount& memoryAccount() { return memoryAccounts.loadScratch; }
+
+    BalanceLedger::Entry toEntry() const {
+        return BalanceLedger::Entry{time, kind, deltaCents, refId};
+    }
+
+    void saveToFile(ostream& file) const {
+        RecordCodec::write(file, *this);
+    }
+
+    static shared_ptr<LedgerRecord> parseRecord(const string& line) {
+        auto record = RecordCodec::decode<LedgerRecord>(line);
+        if (record && (record->kind < BalanceLedger::REGISTRATION || record->kind > BalanceLedger::OPENING)) {
+            return nullptr;
+        }
+        return record;
+    }
+};
+
+// LockBoxSchedule class
+// A recurring or laddered set of releases stored as a single rule. Only
+// the number of installments already released is kept; the next due
+// installment is worked out from the rule during release processing.
+class LockBoxSchedule {
+public:
+   enum Kind {
+       RECURRING,  // Fixed amount locked per installment
+       LADDERED    // Total amount split evenly across the installments
+   };
+
+   // Most installments of one schedule released in a single pass; the
+   // rest stay in the due index for the next pass
+   static const int MAX_RELEASES_PER_PASS = 100;
+
+private:
+   long long id;
+   Kind kind;
+   double installmentAmount;
+   double finalAmount;         // Last installment absorbs laddering remainder
+   time_t firstUnlock;
+   long long intervalSeconds;
+   int installmentCount;
+   int releasedCount;
+   string creationTimestamp;
+   string ownerUsername;
+
+
+public:
+   // Constructor (amount is per installment for RECURRING, total for LADDERED)
+   // Amounts are rounded to whole cents. Defined after LockBox, whose
+   // allocator hands out the id.
+   LockBoxSchedule(Kind k, double amount, time_t first, long long interval,
+                   int count, const string& username);
+
+
+   // Constructor for loading from file
+   LockBoxSchedule(long long scheduleId, Kind k, double amount, double lastAmount,
+                   time_t first, long long interval, int count, int released,
+                   const string& timestamp, const string& username)
+       : id(scheduleId), kind(k), installmentAmount(amount), finalAmount(lastAmount),
+       firstUnlock(first), intervalSeconds(interval), installmentCount(count),
+       releasedCount(released), creationTimestamp(timestamp), ownerUsername(username) {}
+
+
+   // Accessor methods
+   long long getId() const { return id; }
+   Kind getKind() const { return kind; }
+   int getInstallmentCount() const { return installmentCount; }
+   int getReleasedCount() const { return releasedCount; }
+   long long getIntervalSeconds() const { return intervalSeconds; }
+   string getOwnerUsername() const { return ownerUsername; }
+   bool isComplete() const { return releasedCount >= installmentCount; }
+
+
+   // Amount of the given installment (0-based)
+   double getInstallmentAmount(int index) const {
+       return index == installmentCount - 1 ? finalAmount : installmentAmount;
+   }
+
+
+   // Total amount locked by the whole schedule
+   double getTotalAmount() const {
+       return installmentAmount * (installmentCount - 1) + finalAmount;
+   }
+
+
+   // Amount still locked
+   double getRemainingAmount() const {
+       if (isComplete()) return 0.0;
+       return installmentAmount * (installmentCount - 1 - releasedCount) + finalAmount;
+   }
+
+
+   // Unlock time of the next installment
+   time_t getNextUnlockTimestamp() const {
+       return firstUnlock + static_cast<time_t>(releasedCount) * intervalSeconds;
+   }
+
+
+   // Check if the next installment should be released
+   bool isDue(time_t now) const {
+       return !isComplete() && now >= getNextUnlockTimestamp();
+   }
+
+
+   // Release the next installment, returns its amount
+   double releaseNext() {
+       double amount = getInstallmentAmount(releasedCount);
+       releasedCount++;
+       return amount;
+   }
+
+
+   // Persisted fields, in file and loading-constructor order
+   static constexpr auto recordFields() {
+       return make_tuple(&LockBoxSchedule::id, &LockBoxSchedule::kind,
+                         &LockBoxSchedule::installmentAmount, &LockBoxSchedule::finalAmount,
+                         &LockBoxSchedule::firstUnlock, &LockBoxSchedule::intervalSeconds,
+                         &LockBoxSchedule::installmentCount, &LockBoxSchedule::releasedCount,
+                         &LockBoxSchedule::creationTimestamp, &LockBoxSchedule::ownerUsername);
+   }
+
+   // Schedules are counted with the lock boxes they stand in for
+   static MemoryAccount& memoryAccount() { return memoryAccounts.lockBoxes; }
+
+
+   // Save to file stream
+   void saveToFile(ostream& file) const {
+       RecordCodec::write(file, *this);
+   }
+
+
+   // Parse a schedule from one record line, nullptr if a field is missing or malformed
+   static shared_ptr<LockBoxSchedule> parseRecord(const string& line) {
+       auto schedule = RecordCodec::decode<LockBoxSchedule>(line);
+       if (schedule && schedule->kind != RECURRING && schedule->kind != LADDERED) return nullptr;
+       return schedule;
+   }
+
+
+   // Static method to load from file stream
+   static shared_ptr<LockBoxSchedule> loadFromFile(ifstream& file) {
+       string line;
+       if (getline(file, line)) {
+           return parseRecord(line);
+       }
+       return nullptr;
+   }
+};
+
+
+// User class 
+class User : public Person {
+private:
+   double balance;
+   pmr::vector<shared_ptr<LockBox>> lockBoxes{&memoryAccounts.lockBoxes};
+   pmr::vector<shared_ptr<LockBoxSchedule>> schedules{&memoryAccounts.lockBoxes};
+   BalanceLedger ledger;
+   bool active;
+
+public:
+// Constructor 
+User(const string& uname, const string& pass, double initialBalance = 1000.0)
+       : Person(uname, pass), balance(initialBalance), active(true) {
+       ledger.record(Clock::now(), BalanceLedger::REGISTRATION, BalanceLedger::toCents(initialBalance));
+   }
+
+// Constructor for loading from file
+  User(const string& uname, const string& pass, double initialBalance,
+       bool isActive, const string& regDate)
+       : Person(uname, pass, regDate), balance(initialBalance), active(isActive) {}
+
+// Accessor methods 
+double getBalance() const { return balance; }
+   bool isActive() const { return active; }
+
+// Build an immutable record of the user's current state. Hold the user
+// mutex once the user is registered; the release scheduler mutates it.
+ shared_ptr<const UserRecord> makeRecord() const {
+       return makeAccounted<const UserRecord>(UserRecord{
+           username, balance, active, lockBoxes.size(), registrationDate
+       });
+   }
+
+// Publish the current state for snapshot readers (call after each mutation)
+ void publishRecord() const {
+       systemState.publishUserRecord(username, makeRecord());
+   }
 
 // Set user active status 
   void setActive(bool status) {
        active = status;
+       publishRecord();
        string details = "Status changed to " + string(active ? "Active" : "Inactive");
-       TransactionLogger::logTransaction(
+       eventBus.publish(SystemEvent(
            TransactionLogger::USER_STATUS_CHANGE,
            username,
-           details
-       );
+           details
+       ));
+   }
+// Create a new look box
+bool createLockBox(double amount, time_t unlockTimestamp) {
+       if (amount <= 0 || amount > balance) {
+           cout << "Invalid amount or insufficient balance.\n";
+           return false;
+       }
+
+
+       balance -= amount;
+       auto newBox = makeAccounted<LockBox>(amount, unlockTimestamp, username);
+       lockBoxes.push_back(newBox);
+       ledger.record(Clock::now(), BalanceLedger::LOCK, -BalanceLedger::toCents(amount), newBox->getId());
+       dueIndex.add(newBox->getId(), unlockTimestamp, username);
+       publishRecord();
+
+
+       stringstream details;
+       details << "Created Lock Box for " << (unlockTimestamp - Clock::now()) << " seconds";
+       eventBus.publish(SystemEvent(
+           TransactionLogger::CREATE_LOCKBOX,
+           username,
+           details.str(),
+           amount,
+           newBox->getId()
+       ));
+
+
+
+       cout << "Lock Box created successfully! Funds locked for "
+            << (unlockTimestamp - Clock::now()) << " seconds." << endl;
+       return true;
+   }
+
+// Create a recurring or laddered lock box schedule
+bool createSchedule(LockBoxSchedule::Kind kind, double amount, time_t firstUnlock,
+                    long long intervalSeconds, int count) {
+       if (count <= 0 || intervalSeconds <= 0) {
+           cout << "Invalid schedule.\n";
+           return false;
+       }
+
+       // Every installment must be at least one cent once rounded
+       long long amountCents = llround(amount * 100.0);
+       long long installmentCents = kind == LockBoxSchedule::LADDERED ? amountCents / count : amountCents;
+       long long totalCents = kind == LockBoxSchedule::RECURRING ? amountCents * count : amountCents;
+       if (installmentCents <= 0 || totalCents / 100.0 > balance) {
+           cout << "Invalid amount or insufficient balance.\n";
+           return false;
+       }
+
+
+       auto schedule = makeAccounted<LockBoxSchedule>(kind, amount, firstUnlock,
+                                                    intervalSeconds, count, username);
+       balance -= schedule->getTotalAmount();
+       schedules.push_back(schedule);
+       ledger.record(Clock::now(), BalanceLedger::LOCK,
+                     -BalanceLedger::toCents(schedule->getTotalAmount()), schedule->getId());
+       dueIndex.add(schedule->getId(), firstUnlock, username);
+       publishRecord();
+
+
+       stringstream details;
+       details << "Created " << (kind == LockBoxSchedule::LADDERED ? "laddered" : "recurring")
+           << " schedule of " << count << " installments every "
+           << intervalSeconds << " seconds";
+       eventBus.publish(SystemEvent(
+           TransactionLogger::CREATE_SCHEDULE,
+           username,
+           details.str(),
+           schedule->getTotalAmount(),
+           schedule->getId()
+       ));
+
+
+       cout << "Schedule #" << schedule->getId() << " created! $" << fixed << setprecision(2)
+           << schedule->getTotalAmount() << " locked in " << count << " installments." << endl;
+       return true;
+   }
+
+// View user's lock box schedules (caller holds the user mutex)
+ void viewSchedules(size_t pageSize = 0) const {
+       ConsoleRenderer out(pageSize);
+       out.text("\n==== LOCK BOX SCHEDULES ====\n");
+       for (const auto& schedule : schedules) {
+           out.text("ID: ").integer(schedule->getId())
+               .text(schedule->getKind() == LockBoxSchedule::LADDERED ? " | Laddered" : " | Recurring")
+               .text(" | Released: ").integer(schedule->getReleasedCount())
+               .text("/").integer(schedule->getInstallmentCount())
+               .text(" | Still Locked: $").money(schedule->getRemainingAmount());
+           if (!schedule->isComplete()) {
+               out.text(" | Next: $").money(schedule->getInstallmentAmount(schedule->getReleasedCount()))
+                   .text(" at ").date(schedule->getNextUnlockTimestamp());
+           }
+           if (!out.endRow()) break;
+       }
+
+       if (out.getRowCount() == 0) {
+           out.text("No schedules to display.\n");
+       }
+   }
+
+// View user's lock boxes (caller holds the user mutex)
+ void viewLockBoxes(bool showActive = true, bool showReleased = true, size_t pageSize = 0) const {
+       ConsoleRenderer out(pageSize);
+       out.text("\n==== ").text(showActive ? "ACTIVE " : "")
+           .text(showActive && showReleased ? "& " : "")
+           .text(showReleased ? "RELEASED " : "").text("LOCK BOXES ====\n");
+
+
+       for (const auto& box : lockBoxes) {
+           if ((showActive && box->getIsActive()) || (showReleased && !box->getIsActive())) {
+               out.text("ID: ").integer(box->getId())
+                   .text(" | Amount: $").money(box->getAmount())
+                   .text(" | Unlocks In: ");
+               if (box->getIsActive()) {
+                   int secs = box->secondsRemaining();
+                   if (secs > 0)
+                       out.integer(secs).text(" seconds");
+                   else
+                       out.text("Ready to unlock");
+               } else {
+                   out.text("Released at ").date(box->getReleaseTimestamp());
+               }
+               if (!out.endRow()) break;
+           }
+       }
+
+
+       if (out.getRowCount() == 0) {
+           out.text("No lock boxes to display.\n");
+       }
+   }
+
+// Check and release lock boxes that have reached their unlock time 
+ void checkAndReleaseLockBoxes() {
+       bool released = false;
+       vector<shared_ptr<ReleaseEvent>> events;   // Published with the new record
+       for (auto& box : lockBoxes) {
+  if (box->getIsActive() && box->shouldRelease()) {
+               box->release();
+               balance += box->getAmount();
+               released = true;
+               ledger.record(box->getReleaseTimestamp(), BalanceLedger::RELEASE,
+                             BalanceLedger::toCents(box->getAmount()), box->getId());
+               dueIndex.remove(box->getId(), box->getUnlockTimestamp());
+
+
+               auto event = makeAccounted<ReleaseEvent>(
+                   box->getId(),
+                   box->getReleaseTimestamp(),
+                   box->getAmount(),
+                   username
+               );
+               events.push_back(event);
+
+
+               string details = "Lock Box #" + to_string(box->getId()) + " released";
+               // Logging, receipts and the owner's notification are handled
+               // by event bus subscribers, off the release path
+               eventBus.publish(SystemEvent(
+                   TransactionLogger::RELEASE_LOCKBOX,
+                   username,
+                   details,
+                   box->getAmount(),
+                   box->getId(),
+                   event
+               ));
+           }
+       }
+
+       // Materialize due schedule installments
+       time_t now = Clock::now();
+       for (auto& schedule : schedules) {
+           if (!schedule->isDue(now)) continue;
+           dueIndex.remove(schedule->getId(), schedule->getNextUnlockTimestamp());
+           for (int n = 0; n < LockBoxSchedule::MAX_RELEASES_PER_PASS && schedule->isDue(now); n++) {
+               int installment = schedule->getReleasedCount() + 1;
+               double amount = schedule->releaseNext();
+               balance += amount;
+               released = true;
+               ledger.record(now, BalanceLedger::RELEASE, BalanceLedger::toCents(amount), schedule->getId());
+
+
+               auto event = makeAccounted<ReleaseEvent>(schedule->getId(), now, amount, username);
+               events.push_back(event);
+
+
+               string details = "Schedule #" + to_string(schedule->getId()) + " installment " +
+                   to_string(installment) + " of " +
+                   to_string(schedule->getInstallmentCount()) + " released";
+               eventBus.publish(SystemEvent(
+                   TransactionLogger::RELEASE_LOCKBOX,
+                   username,
+                   details,
+                   amount,
+                   schedule->getId(),
+                   event
+               ));
+           }
+           if (!schedule->isComplete()) {
+               dueIndex.add(schedule->getId(), schedule->getNextUnlockTimestamp(), username);
+           }
+       }
+
+       if (released) {
+           systemState.publishRelease(username, makeRecord(), move(events));
+       }
+   }
+
+// Display user details from the last published record, so no lock is needed
+ void displayDetails() const override {
+       auto record = systemState.findUserRecord(username);
+       if (record) record->displayDetails();
+ }
+
+// Add a lock box to the user 
+ void addLockBox(shared_ptr<LockBox> box) {
+       lockBoxes.push_back(box);
+       publishRecord();
+   }
+
+// Get all lock boxes
+const pmr::vector<shared_ptr<LockBox>>& getLockBoxes() const {
+       return lockBoxes;
+   }
+
+// Add a schedule to the user
+ void addSchedule(shared_ptr<LockBoxSchedule> schedule) {
+       schedules.push_back(schedule);
+   }
+
+// Get all schedules
+const pmr::vector<shared_ptr<LockBoxSchedule>>& getSchedules() const {
+       return schedules;
+   }
+
+// Balance ledger, and adding entries to it when loading
+const BalanceLedger& getLedger() const {
+       return ledger;
+   }
+
+ void addLedgerEntry(const BalanceLedger::Entry& entry) {
+       ledger.record(entry.time, entry.kind, entry.deltaCents, entry.refId);
+   }
+
+// Insert a ledger entry at its own time, for repairs of older history
+ void insertLedgerEntry(const BalanceLedger::Entry& entry) {
+       ledger.insert(entry);
+   }
+
+// View the ledger entries of one calendar month (caller holds the user mutex)
+ void viewStatement(int year, int month, size_t pageSize = 0) const {
+       tm start = {};
+       start.tm_year = year - 1900;
+       start.tm_mon = month - 1;
+       start.tm_mday = 1;
+       start.tm_isdst = -1;
+       tm end = start;
+       end.tm_mon++;
+       BalanceLedger::Statement statement = ledger.statement(mktime(&start), mktime(&end));
+
+       ConsoleRenderer out(pageSize);
+       out.text("\n==== STATEMENT ").integer(year).text("-").text(month < 10 ? "0" : "")
+           .integer(month).text(" ====\n");
+       out.text("Opening balance: $").money(statement.openingCents / 100.0).text("\n");
+       const auto& entries = ledger.getEntries();
+       for (size_t i = statement.first; i < statement.last; i++) {
+           const auto& entry = entries[i];
+           out.date(entry.time).text(" | ").text(BalanceLedger::kindName(entry.kind))
+               .text(entry.deltaCents >= 0 ? " | +$" : " | -$")
+               .money((entry.deltaCents >= 0 ? entry.deltaCents : -entry.deltaCents) / 100.0);
+           if (entry.refId >= 0) {
+               out.text(" | #").integer(entry.refId);
+           }
+           if (!out.endRow()) return;
+       }
+       if (statement.first == statement.last) {
+           out.text("No transactions in this month.\n");
+       }
+       out.text("Closing balance: $").money(statement.closingCents / 100.0).text("\n");
+   }
+
+// Persisted fields, in file and loading-constructor order
+ static constexpr auto recordFields() {
+       return make_tuple(&User::username, &User::password, &User::balance,
+                         &User::active, &User::registrationDate);
+   }
+
+ static MemoryAccount& memoryAccount() { return memoryAccounts.users; }
+
+// Save user data to file
+void saveToFile(ostream& file) const override {
+       RecordCodec::write(file, *this);
+   }
+
+// Parse a user from one record line, nullptr if a field is missing or malformed
+ static shared_ptr<User> parseRecord(const string& line) {
+       return RecordCodec::decode<User>(line);
+   }
+
+// Load user from file
+ static shared_ptr<User> loadFromFile(ifstream& file) {
+=======
+
+
+// Lock box id allocator
+// Ids are 64-bit. Each thread leases a block of ids from the shared atomic
+// counter and hands them out locally, so bulk creation from many threads
+// rarely touches the shared counter. Leases are kept per allocator, and
+// generations are unique across allocators, so a lease never outlives a
+// reset or carries over to another allocator at the same address.
+class IdAllocator {
+public:
+    static const long long BLOCK_SIZE = 64;
+
+private:
+    atomic<long long> highWater;     // First id that has not been leased yet
+    atomic<long long> generation;    // Replaced to invalidate outstanding leases
+    static atomic<long long> generations;
+
+    struct Lease {
+        long long next = 0;
+        long long end = 0;
+        long long generation = -1;
+    };
+
+public:
+    IdAllocator(long long firstId = 1) : highWater(firstId), generation(generations.fetch_add(1)) {}
+
+    // Allocate the next id, leasing a new block when the local one runs out
+    long long allocate() {
+        thread_local unordered_map<const IdAllocator*, Lease> leases;
+        Lease& lease = leases[this];
+        long long currentGeneration = generation.load(memory_order_acquire);
+        if (lease.generation != currentGeneration || lease.next == lease.end) {
+            lease.next = highWater.fetch_add(BLOCK_SIZE, memory_order_relaxed);
+            lease.end = lease.next + BLOCK_SIZE;
+            lease.generation = currentGeneration;
+        }
+        return lease.next++;
+    }
+
+    // Make sure an existing id is never handed out again
+    void observe(long long id) {
+        long long expected = highWater.load(memory_order_relaxed);
+        while (id >= expected && !highWater.compare_exchange_weak(expected, id + 1)) {
+        }
+    }
+
+    // Restart allocation at the given high-water mark
+    void reset(long long mark) {
+        highWater.store(mark);
+        generation.store(generations.fetch_add(1), memory_order_release);
+    }
+
+    long long getHighWater() const { return highWater.load(); }
+
+    // Persist the high-water mark
+    void saveToFile(const string& filename) const {
+        ofstream file(filename);
+        if (file.is_open()) {
+            file << getHighWater() << endl;
+        }
+    }
+
+    // Restore the high-water mark, returns false if there is no valid file
+    bool loadFromFile(const string& filename) {
+        ifstream file(filename);
+        long long mark;
+        if (file.is_open() && (file >> mark) && mark > 0) {
+            reset(mark);
+            return true;
+        }
+        return false;
+    }
+};
+
+
+// LockBox class - Team Member 2
+class LockBox {
+private:
+   static IdAllocator idAllocator;
+   long long id;
+   double amount;
+   time_t unlockTimestamp;
+   bool isActive;
+   time_t releaseTimestamp;
+   string creationTimestamp;
+   string ownerUsername;
+
+
+public:
+   // Constructor
+   LockBox(double amt, time_t uTimestamp, const string& username)
+       : amount(amt), unlockTimestamp(uTimestamp), isActive(true), ownerUsername(username) {
+       id = idAllocator.allocate();
+       releaseTimestamp = 0;
+       creationTimestamp = getCurrentDateTime();
+   }
+
+
+   // Constructor for loading from file
+   LockBox(long long boxId, double amt, time_t uTimestamp, bool active,
+           time_t rTimestamp, const string& timestamp, const string& username)
+       : id(boxId), amount(amt), unlockTimestamp(uTimestamp), isActive(active),
+       releaseTimestamp(rTimestamp), creationTimestamp(timestamp), ownerUsername(username) {}
+
+
+   // Shared id allocator, used when loading and saving data
+   static IdAllocator& getIdAllocator() { return idAllocator; }
+
+
+   // Accessor methods
+   long long getId() const { return id; }
+   double getAmount() const { return amount; }
+   time_t getUnlockTimestamp() const { return unlockTimestamp; }
+   bool getIsActive() const { return isActive; }
+   time_t getReleaseTimestamp() const { return releaseTimestamp; }
+   string getCreationTimestamp() const { return creationTimestamp; }
+   string getOwnerUsername() const { return ownerUsername; }
+
+
+   // Release the lock box
+   void release() {
+       isActive = false;
+       releaseTimestamp = Clock::now();
+   }
+
+
+   // Calculate seconds remaining until unlock
+   int secondsRemaining() const {
+       if (!isActive) return 0;
+       time_t now = Clock::now();
+       return static_cast<int>(unlockTimestamp - now);
+   }
+
+
+   // Check if lock box should be released
+   bool shouldRelease() const {
+       if (!isActive) return false;
+       time_t now = Clock::now();
+       return now >= unlockTimestamp;
+   }
+
+
+   // Persisted fields, in file and loading-constructor order
+   static constexpr auto recordFields() {
+       return make_tuple(&LockBox::id, &LockBox::amount, &LockBox::unlockTimestamp,
+                         &LockBox::isActive, &LockBox::releaseTimestamp,
+                         &LockBox::creationTimestamp, &LockBox::ownerUsername);
+   }
+
+   static MemoryAccount& memoryAccount() { return memoryAccounts.lockBoxes; }
+
+
+   // Save to file stream
+   void saveToFile(ostream& file) const {
+       RecordCodec::write(file, *this);
+   }
+
+
+   // Parse a lock box from one record line, nullptr if a field is missing or malformed
+   static shared_ptr<LockBox> parseRecord(const string& line) {
+       return RecordCodec::decode<LockBox>(line);
+   }
+
+
+   // Static method to load from file stream
+   static shared_ptr<LockBox> loadFromFile(ifstream& file) {
+       string line;
+       if (getline(file, line)) {
+           istringstream iss(line);
+           string token;
+           vector<string> tokens;
+
+
+           while (getline(iss, token, '|')) {
+               tokens.push_back(token);
+           }
+
+           if (tokens.size() >= 5) {
+               string uname = tokens[0];
+               string pass = tokens[1];
+               double balance = stod(tokens[2]);
+               bool active = stoi(tokens[3]) == 1;
+               string regDate = tokens[4];
+
+
+               return make_shared<User>(uname, pass, balance, active, regDate);
+           }
+ }
+       return nullptr;
+   }
+};
+
+
+// Admin class
+class Admin : public Person {
+public:
+   // Constructor =
+   Admin(const string& uname, const string& pass)
+       : Person(uname, pass) {}
+
+
+   // Constructor for loading from file 
+   Admin(const string& uname, const string& pass, const string& regDate)
+       : Person(uname, pass, regDate) {}
+
+
+   // Display admin details 
+   void displayDetails() const override {
+       cout << "Admin Username: " << username
+           << " | Registration Date: " << registrationDate << endl;
+   }
+
+
+   // View all users (reads a snapshot, so writers are never blocked)
+   void viewAllUsers(size_t pageSize = 0) const {
+       viewAllUsers(systemState.takeSnapshot().users, pageSize);
+   }
+
+
+   // View the given user records, sorted by username
+   void viewAllUsers(const vector<shared_ptr<const UserRecord>>& users, size_t pageSize) const {
+       cout << "\n==== ALL USERS ====\n";
+       if (users.empty()) {
+           cout << "No users registered.\n";
+           return;
+       }
+
+
+       ConsoleRenderer out(pageSize);
+       for (const auto& record : users) {
+           if (!record->render(out)) break;
+       }
+   }
+
+
+   // Toggle user active status 
+   void toggleUserStatus(const string& username) {
+       auto user = systemState.findUser(username);
+       if (!user) {
+           cout << "User not found.\n";
+           return;
+       }
+
+       EventBus::Batch events(eventBus);
+       lock_guard<mutex> guard(systemState.getUserMutex(username));
+       user->setActive(!user->isActive());
+       cout << "User " << username << " status changed to "
+           << (user->isActive() ? "Active" : "Inactive") << endl;
+   }
+
+
+   // View release log 
+   // Reads a snapshot, walking the shared log chunks in place
+   void viewReleaseLog(size_t pageSize = 0) const {
+       StateSnapshot snapshot = systemState.takeSnapshot();
+       cout << "\n==== RELEASE EVENT LOG ====\n";
+       if (snapshot.releaseLog.size() == 0) {
+           cout << "No release events have occurred.\n";
+           return;
+       }
+
+       ConsoleRenderer out(pageSize);
+       snapshot.releaseLog.forEach([&out](const shared_ptr<ReleaseEvent>& event) {
+           return renderReleaseEvent(out, *event);
+       });
+   }
+
+
+   // View the given release events in order
+   void viewReleaseLog(const vector<shared_ptr<ReleaseEvent>>& events, size_t pageSize) const {
+       cout << "\n==== RELEASE EVENT LOG ====\n";
+       if (events.empty()) {
+           cout << "No release events have occurred.\n";
+           return;
+       }
+
+
+       ConsoleRenderer out(pageSize);
+       for (const auto& event : events) {
+           if (!renderReleaseEvent(out, *event)) break;
+       }
+   }
+
+
+   // One release log row, false once the reader stops paging
+   static bool renderReleaseEvent(ConsoleRenderer& out, const ReleaseEvent& event) {
+       out.text("Lock Box ID: ").integer(event.getLockBoxId())
+           .text(" | User: ").text(event.getUsername())
+           .text(" | Released At: ").date(event.getReleaseTimestamp())
+           .text(" | Amount: $").money(event.getReleasedAmount());
+       return out.endRow();
+   }
+
+
+   // Show transaction search results
+   void viewTransactions(const vector<TransactionIndex::Entry>& entries, size_t pageSize,
+                         double elapsedMs) const {
+       cout << "\n==== TRANSACTION SEARCH ====\n";
+       cout << entries.size() << " matching transaction(s) in " << fixed << setprecision(2)
+           << elapsedMs << " ms";
+       if (!transactionIndex.isHistoryLoaded()) {
+           cout << " (older logs are still being indexed)";
+       }
+       cout << "\n";
+
+       ConsoleRenderer out(pageSize);
+       for (const auto& entry : entries) {
+           out.date(entry.time)
+               .text(" | ").text(TransactionLogger::getTransactionTypeName(entry.type))
+               .text(" | User: ").text(entry.username)
+               .text(" | Amount: $").money(entry.amountCents / 100.0);
+           if (entry.lockBoxId >= 0) {
+               out.text(" | Lock Box ID: ").integer(entry.lockBoxId);
+           }
+           if (!entry.details.empty()) {
+               out.text(" | ").text(entry.details);
+           }
+           if (!out.endRow()) break;
+       }
+   }
+
+
+   // Show how much memory each subsystem holds
+   void viewMemoryUsage(const vector<MemoryAccount::Stats>& stats) const {
+       cout << "\n==== MEMORY USAGE (" << memoryAccounts.getModeName() << " mode) ====\n";
+       ConsoleRenderer out;
+       for (const auto& account : stats) {
+           out.text(account.name)
+               .text(" | In Use: ").integer(account.bytesInUse)
+               .text(" bytes in ").integer(account.liveAllocations)
+               .text(" blocks | Peak: ").integer(account.peakBytes)
+               .text(" bytes | Allocations: ").integer(account.totalAllocations);
+           out.endRow();
+       }
+       out.text("Saved to ").text(MEMORY_STATS_FILE);
+       out.endRow();
+   }
+
+
+   // Clear release logs 
+   void clearReleaseLogs() {
+       systemState.clearReleaseLog();
+       cout << "Release logs cleared.\n";
+   }
+};
+
+
+// Register a new user once the username has been entered
+void registerUser(const string& username) {
+   string password;
+   double initialBalance;
+
+
+   // Check if username already exists
+   if (systemState.findUser(username)) {
+       cout << "Username already exists. Please choose another.\n";
+       return;
+   }
+
+
+   cout << "Enter password: ";
+   cin >> password;
+
+
+   cout << "Enter initial balance: $";
+   cin >> initialBalance;
+
+
+   if (initialBalance < 0) {
+       cout << "Initial balance cannot be negative.\n";
+       return;
+   }
+
+
+   // Insert is re-checked under the shard lock in case of a concurrent registration
+   auto newUser = makeAccounted<User>(username, password, initialBalance);
+   if (!systemState.addUser(username, newUser, newUser->makeRecord())) {
+       cout << "Username already exists. Please choose another.\n";
+       return;
+   }
+   receiptLayout.ensureUserDir(username);
+
+
+   // Log the transaction
+   eventBus.publish(SystemEvent(
+       TransactionLogger::USER_REGISTRATION,
+       username,
+       "User registered",
+       initialBalance
+   ));
+
+
+   cout << "User registered successfully!\n";
+}
+
+
+// Function to register a new user 
+void registerUser() {
+   string username;
+
+
+   cout << "\n==== USER REGISTRATION ====\n";
+   cout << "Enter username: ";
+   cin >> username;
+   registerUser(username);
+}
+
+
+// Log a user in with the given credentials: throttling, checks, the
+// login event and release processing. Also used by the workload harness.
+bool loginUser(const string& username, const string& password) {
+   auto user = systemState.findUser(username);
+   if (!loginThrottle.allow(username, user != nullptr)) {
+       cout << "Too many login attempts. Please try again later.\n";
+       return false;
+   }
+
+
+   if (!user) {
+       loginThrottle.recordFailure(username, false);
+       cout << "User not found.\n";
+       return false;
+   }
+
+
+   if (!user->isActive()) {
+       cout << "This account is inactive. Please contact the admin.\n";
+       return false;
+   }
+
+
+   if (!user->checkPassword(password)) {
+       loginThrottle.recordFailure(username, true);
+       cout << "Incorrect password.\n";
+       return false;
+   }
+
+
+   currentUser = user;
+   isUserLoggedIn = true;
+
+
+   // Log the transaction
+   eventBus.publish(SystemEvent(
+       TransactionLogger::USER_LOGIN,
+       username,
+       "User login"
+   ));
+
+
+   cout << "Login successful! Welcome, " << username << "!\n";
+   {
+       EventBus::Batch events(eventBus);
+       lock_guard<mutex> guard(systemState.getUserMutex(username));
+       currentUser->checkAndReleaseLockBoxes(); // Check for unlockable boxes on login
+   }
+   eventBus.flush();
+   showNotifications(username);
+   return true;
+}
+
+
+// Log a user in once the username has been entered
+bool loginUser(const string& username) {
+   string password;
+
+
+   cout << "Enter password: ";
+   cin >> password;
+   return loginUser(username, password);
+}
+
+
+// Function to login a user 
+bool loginUser() {
+   string username;
+
+
+   cout << "\n==== USER LOGIN ====\n";
+   cout << "Enter username: ";
+   cin >> username;
+   return loginUser(username);
+}
+
+
+// Function to login admin 
+bool loginAdmin() {
+   string username, password;
+
+
+   cout << "\n==== ADMIN LOGIN ====\n";
+   cout << "Enter admin username: ";
+   cin >> username;
+   cout << "Enter admin password: ";
+   cin >> password;
+
+
+   if (!loginThrottle.allow(username, username == systemAdmin->getUsername())) {
+       cout << "Too many login attempts. Please try again later.\n";
+       return false;
+   }
+
+
+   if (systemAdmin->getUsername() == username && systemAdmin->checkPassword(password)) {
+       isAdminLoggedIn = true;
+
+
+       // Log the transaction
+       eventBus.publish(SystemEvent(
+           TransactionLogger::ADMIN_LOGIN,
+           username,
+           "Admin login"
+       ));
+
+
+       cout << "Admin login successful!\n";
+       return true;
+   }
+
+
+   loginThrottle.recordFailure(username, username == systemAdmin->getUsername());
+   cout << "Invalid admin credentials.\n";
+   return false;
+}
+
+// Display user menu
+void displayUserMenu() {
+   cout << "\n==== USER MENU ====\n";
+   cout << "1. Create Lock Box\n";
+   cout << "2. View Active Lock Boxes\n";
+   cout << "3. View Released Lock Boxes\n";
+   cout << "4. View All Lock Boxes\n";
+   cout << "5. Check Balance\n";
+   cout << "6. Create Lock Box Schedule\n";
+   cout << "7. View Schedules\n";
+   cout << "8. View Monthly Statement\n";
+   cout << "9. Logout\n";
+   cout << "Enter your choice: ";
+}
+
+
+// Display admin menu 
+void displayAdminMenu() {
+   cout << "\n==== ADMIN MENU ====\n";
+   cout << "1. View All Users\n";
+   cout << "2. Toggle User Status (Activate/Deactivate)\n";
+   cout << "3. View Release Log\n";
+   cout << "4. Clear Release Logs\n";
+   cout << "5. Search Transactions\n";
+   cout << "6. Memory Usage\n";
+   cout << "7. Logout\n";
+   cout << "Enter your choice: ";
+}
+
+
+// Ask how many rows a listing should show per page
+size_t readPageSize() {
+   long long pageSize = 0;
+   cout << "Rows per page (0 = all): ";
+   if (!(cin >> pageSize)) {
+       // Not a number: show everything and drop the rest of the line
+       cin.clear();
+       cin.ignore(numeric_limits<streamsize>::max(), '\n');
+       return 0;
    }
-// Create a new look box
-bool createLockBox(double amount, time_t unlockTimestamp) {
-       if (amount <= 0 || amount > balance) {
-           cout << "Invalid amount or insufficient balance.\n";
+   return pageSize > 0 ? static_cast<size_t>(pageSize) : 0;
+}
+
+
+// Write memory statistics to the dump file, one account per line
+void saveMemoryStats(const vector<MemoryAccount::Stats>& stats) {
+   string dump = "#memory|" + string(memoryAccounts.getModeName()) + "|" + getCurrentDateTime() + "\n";
+   for (const auto& account : stats) {
+       RecordCodec::encode(account, dump);
+       dump += '\n';
+   }
+   asyncWriter.writeFile(MEMORY_STATS_FILE, move(dump));
+}
+
+
+// Ask for the transaction search filters, false if the type is unknown
+bool readTransactionQuery(TransactionIndex::Query& query) {
+   string type, username;
+   double minAmount, maxAmount;
+   long long days;
+
+   cout << "Transaction type (* = any): ";
+   cin >> type;
+   if (type != "*") {
+       TransactionLogger::TransactionType parsed;
+       if (!TransactionLogger::parseTransactionType(type, parsed)) {
+           cout << "Unknown transaction type. Types are logged in upper case, e.g. CREATE_LOCKBOX.\n";
            return false;
        }
+       query.type = parsed;
+   }
+   cout << "Username (* = any): ";
+   cin >> username;
+   if (username != "*") query.username = username;
+   cout << "Lock box ID (-1 = any): ";
+   cin >> query.lockBoxId;
+   cout << "Minimum amount (-1 = no limit): ";
+   cin >> minAmount;
+   cout << "Maximum amount (-1 = no limit): ";
+   cin >> maxAmount;
+   query.minCents = minAmount < 0 ? -1 : llround(minAmount * 100.0);
+   query.maxCents = maxAmount < 0 ? -1 : llround(maxAmount * 100.0);
+   cout << "Only the last N days (0 = all): ";
+   cin >> days;
+   if (days > 0) query.from = Clock::now() - days * 24 * 60 * 60;
+   return static_cast<bool>(cin);
+}
 
 
-       balance -= amount;
-       auto newBox = make_shared<LockBox>(amount, unlockTimestamp, username);
-       lockBoxes.push_back(newBox);
+// Display main menu 
+void displayMainMenu() {
+   cout << "\n==== TIME-LOCKED SAVINGS SYSTEM ====\n";
+   cout << "1. Register User\n";
+   cout << "2. User Login\n";
+   cout << "3. Admin Login\n";
+   cout << "4. Exit\n";
+   cout << "Enter your choice: ";
+}
 
 
-       stringstream details;
-       details << "Created Lock Box for " << (unlockTimestamp - time(0)) << " seconds";
-       TransactionLogger::logTransaction(
-           TransactionLogger::CREATE_LOCKBOX,
-           username,
-           details.str(),
-           amount
-       );
+// Process user menu 
+void processUserMenu() {
+   int choice;
+   showNotifications(currentUser->getUsername());
+   displayUserMenu();
+   cin >> choice;
 
 
-       TransactionLogger::generateReceipt(
-           TransactionLogger::CREATE_LOCKBOX,
-           username,
-           details.str(),
-           amount,
-           newBox->getId()
-       );
+   switch (choice) {
+       case 1: {
+           // Create Lock Box
+           double amount;
+           int seconds;
 
 
+           cout << "Enter amount to lock: $";
+           cin >> amount;
 
-       cout << "Lock Box created successfully! Funds locked for "
-            << (unlockTimestamp - time(0)) << " seconds." << endl;
-       return true;
-   }
 
-// View user's lock boxes
- void viewLockBoxes(bool showActive = true, bool showReleased = true) const {
-       bool found = false;
-       cout << "\n==== " << (showActive ? "ACTIVE " : "")
-           << (showActive && showReleased ? "& " : "")
-           << (showReleased ? "RELEASED " : "") << "LOCK BOXES ====\n";
+           cout << "Enter lock duration in seconds: ";
+           cin >> seconds;
 
 
-       for (const auto& box : lockBoxes) {
-           if ((showActive && box->getIsActive()) || (showReleased && !box->getIsActive())) {
-               cout << "ID: " << box->getId()
-                   << " | Amount: $" << fixed << setprecision(2) << box->getAmount()
-                   << " | Unlocks In: ";
-               if (box->getIsActive()) {
-                   int secs = box->secondsRemaining();
-                   if (secs > 0)
-                       cout << secs << " seconds";
-                   else
-                       cout << "Ready to unlock";
-               } else {
-                   time_t released = box->getReleaseTimestamp();
-                   cout << "Released at " << ctime(&released);
-               }
-               cout << endl;
-               found = true;
+           if (seconds <= 0) {
+               cout << "Invalid duration. Please enter a positive number of seconds.\n";
+               break;
+           }
+
+
+           time_t now = Clock::now();
+           time_t unlockTimestamp = now + seconds;
+           EventBus::Batch events(eventBus);
+           lock_guard<mutex> guard(systemState.getUserMutex(currentUser->getUsername()));
+           currentUser->createLockBox(amount, unlockTimestamp);
+           break;
+       }
+       case 2: {
+           // View Active Lock Boxes (the release scheduler may be changing them)
+           lock_guard<mutex> guard(systemState.getUserMutex(currentUser->getUsername()));
+           currentUser->viewLockBoxes(true, false);
+           break;
+       }
+       case 3: {
+           // View Released Lock Boxes
+           lock_guard<mutex> guard(systemState.getUserMutex(currentUser->getUsername()));
+           currentUser->viewLockBoxes(false, true);
+           break;
+       }
+       case 4: {
+           // View All Lock Boxes
+           lock_guard<mutex> guard(systemState.getUserMutex(currentUser->getUsername()));
+           currentUser->viewLockBoxes(true, true);
+           break;
+       }
+       case 5: {
+           // Check Balance
+           double balance;
+           {
+               lock_guard<mutex> guard(systemState.getUserMutex(currentUser->getUsername()));
+               balance = currentUser->getBalance();
            }
+           cout << "Current balance: $" << fixed << setprecision(2) << balance << endl;
+           break;
        }
+       case 6: {
+           // Create Lock Box Schedule
+           char kind;
+           double amount;
+           int seconds, count;
+           long long interval;
+
+
+           cout << "Schedule type (R = recurring, L = laddered): ";
+           cin >> kind;
+           bool laddered = kind == 'L' || kind == 'l';
+
+           cout << (laddered ? "Enter total amount to ladder: $" : "Enter amount per installment: $");
+           cin >> amount;
+
+           cout << "Enter number of installments: ";
+           cin >> count;
+
+           cout << "Enter seconds until the first release: ";
+           cin >> seconds;
+
+           cout << "Enter seconds between releases: ";
+           cin >> interval;
+
+
+           if (seconds <= 0) {
+               cout << "Invalid duration. Please enter a positive number of seconds.\n";
+               break;
+           }
 
 
-       if (!found) {
-           cout << "No lock boxes to display.\n";
+           EventBus::Batch events(eventBus);
+           lock_guard<mutex> guard(systemState.getUserMutex(currentUser->getUsername()));
+           currentUser->createSchedule(
+               laddered ? LockBoxSchedule::LADDERED : LockBoxSchedule::RECURRING,
+               amount, Clock::now() + seconds, interval, count);
+           break;
+       }
+       case 7: {
+           // View Schedules
+           lock_guard<mutex> guard(systemState.getUserMutex(currentUser->getUsername()));
+           currentUser->viewSchedules();
+           break;
+       }
+       case 8: {
+           // View Monthly Statement
+           int year, month;
+           cout << "Enter statement month (YYYY MM): ";
+           cin >> year >> month;
+           if (month < 1 || month > 12) {
+               cout << "Invalid month.\n";
+               break;
+           }
+           lock_guard<mutex> guard(systemState.getUserMutex(currentUser->getUsername()));
+           currentUser->viewStatement(year, month);
+           break;
        }
+       case 9:
+           // Logout
+           cout << "Logging out...\n";
+           // Log the transaction
+           eventBus.publish(SystemEvent(
+               TransactionLogger::USER_LOGOUT,
+               currentUser->getUsername(),
+               "User logout"
+           ));
+           currentUser = nullptr;
+           isUserLoggedIn = false;
+           break;
+       default:
+           cout << "Invalid choice. Please try again.\n";
+           break;
    }
+}
 
-// Check and release lock boxes that have reached their unlock time 
- void checkAndReleaseLockBoxes() {
-       for (auto& box : lockBoxes) {
-  if (box->getIsActive() && box->shouldRelease()) {
-               box->release();
-               balance += box->getAmount();
+// Checkpoint generation of the data files currently on disk
+long long checkpointGeneration = 0;
 
+// Set when the last load found problems; saves then leave the .bak files
+// alone so the previous checkpoint stays available to --recover
+bool keepBackupCheckpoint = false;
 
-               auto event = make_shared<ReleaseEvent>(
-                   box->getId(),
-                   box->getReleaseTimestamp(),
-                   box->getAmount(),
-                   username
-               );
-               releaseLog.push_back(event);
 
+// 32-bit FNV-1a hash, stable across builds and platforms
+unsigned int fnv1a(const string& text) {
+   unsigned int hash = 2166136261u;
+   for (unsigned char c : text) {
+       hash = (hash ^ c) * 16777619u;
+   }
+   return hash;
+}
 
-               string details = "Lock Box #" + to_string(box->getId()) + " released";
-               TransactionLogger::logTransaction(
-                   TransactionLogger::RELEASE_LOCKBOX,
-                   username,
-                   details,
-                   box->getAmount()
-               );
 
+// Checksum of a record line (FNV-1a, as 8 hex digits)
+string recordChecksum(const string& line) {
+   char digits[9];
+   snprintf(digits, sizeof(digits), "%08x", fnv1a(line));
+   return string(digits);
+}
 
-               TransactionLogger::generateReceipt(
-                   TransactionLogger::RELEASE_LOCKBOX,
-                   username,
-                   details,
-                   box->getAmount(),
-                   box->getId()
-               );
+
+// Integrity status of one record line
+enum RecordStatus {
+   RECORD_OK,          // Checksum present and valid
+   RECORD_UNCHECKED,   // Written before checksums were added
+   RECORD_CORRUPT      // Checksum present but wrong
+};
 
 
-               cout << "\n*** NOTIFICATION: Lock Box #" << box->getId()
-                   << " has been unlocked! $" << fixed << setprecision(2)
-                   << box->getAmount() << " has been returned to your balance. ***\n";
-           }
+// Verify and strip the "|#xxxxxxxx" checksum suffix of a record line
+RecordStatus verifyRecord(string& line) {
+   if (!line.empty() && line.back() == '\r') line.pop_back();
+   size_t pos = line.rfind("|#");
+   if (pos == string::npos || line.size() - pos != 10) {
+       return RECORD_UNCHECKED;
+   }
+   if (recordChecksum(line.substr(0, pos)) != line.substr(pos + 2)) {
+       return RECORD_CORRUPT;
+   }
+   line.resize(pos);
+   return RECORD_OK;
+}
+
+
+// Writes one data file of a checkpoint. Every record gets a checksum and
+// the file starts with the checkpoint generation. Records are built in
+// memory and written to a .tmp file by the async writer; commit() keeps
+// the previous file as .bak and renames the new one into place, so a
+// crash never leaves only a half-written file.
+class CheckpointWriter {
+private:
+   string path;
+   string contents;
+   string record;      // Reused for every record
+
+public:
+   CheckpointWriter(const string& target, long long generation) : path(target) {
+       writeLine("#checkpoint|" + to_string(generation));
+   }
+
+   void writeLine(const string& line) {
+       contents += line;
+       contents += "|#";
+       contents += recordChecksum(line);
+       contents += '\n';
+   }
+
+   // Write any type with a record schema as one record
+   template <typename T>
+   void write(const T& item) {
+       record.clear();
+       RecordCodec::encode(item, record);
+       writeLine(record);
+   }
+
+   // Queue the .tmp file write; the future tells whether it is on disk
+   future<bool> finish() {
+       return asyncWriter.writeFile(path + ".tmp", move(contents), true);
+   }
+
+   // Move the finished file into place, keeping the old one as .bak.
+   // The renames are durable once syncDirectory() has run.
+   bool commit() {
+       error_code ec;
+       if (!keepBackupCheckpoint && filesystem::exists(path, ec)) {
+           filesystem::rename(path, path + ".bak", ec);
        }
+       filesystem::rename(path + ".tmp", path, ec);
+       return !ec;
    }
 
-// Display user details 
- void displayDetails() const override {
-       cout << "Username: " << username
-           << " | Balance: $" << fixed << setprecision(2) << balance
-           << " | Status: " << (active ? "Active" : "Inactive")
-           << " | Lock Boxes: " << lockBoxes.size()
-           << " | Registration Date: " << registrationDate << endl;
- }
+   // Flush renames in the data directory to disk
+   static void syncDirectory() {
+#ifdef CHECKPOINT_USE_FSYNC
+       int fd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+       if (fd >= 0) {
+           fsync(fd);
+           close(fd);
+       }
+#endif
+   }
+};
 
-// Add a lock box to the user 
- void addLockBox(shared_ptr<LockBox> box) {
-       lockBoxes.push_back(box);
+
+// Totals journaled with each checkpoint, in cents to avoid rounding drift
+struct CheckpointTotals {
+   long long generation = 0;
+   long long users = 0;
+   long long balanceCents = 0;
+   long long boxes = 0;
+   long long activeBoxCents = 0;
+   long long scheduledCents = 0;
+   long long releases = 0;
+   long long releasedCents = 0;
+
+   static long long cents(double amount) { return llround(amount * 100.0); }
+
+   bool matches(const CheckpointTotals& other) const {
+       return users == other.users && balanceCents == other.balanceCents &&
+           boxes == other.boxes && activeBoxCents == other.activeBoxCents &&
+           scheduledCents == other.scheduledCents && releases == other.releases &&
+           releasedCents == other.releasedCents;
    }
 
-// Get all lock boxes
-const vector<shared_ptr<LockBox>>& getLockBoxes() const {
-       return lockBoxes;
+   static constexpr auto recordFields() {
+       return make_tuple(&CheckpointTotals::generation, &CheckpointTotals::users,
+                         &CheckpointTotals::balanceCents, &CheckpointTotals::boxes,
+                         &CheckpointTotals::activeBoxCents, &CheckpointTotals::scheduledCents,
+                         &CheckpointTotals::releases, &CheckpointTotals::releasedCents);
    }
 
-// Save user data to file
-void saveToFile(ofstream& file) const override {
-       file << username << "|"
-           << password << "|"
-           << balance << "|"
-           << (active ? 1 : 0) << "|"
-           << registrationDate << endl;
+   void saveToFile(ostream& file) const {
+       RecordCodec::write(file, *this);
    }
 
-// Load user from file
- static shared_ptr<User> loadFromFile(ifstream& file) {
-=======
+   static bool parseRecord(const string& line, CheckpointTotals& totals) {
+       auto decoded = RecordCodec::decode<CheckpointTotals>(line);
+       if (!decoded) return false;
+       totals = *decoded;
+       return true;
+   }
+};
 
 
-// LockBox class - Team Member 2
-class LockBox {
-private:
-   static int nextId;
-   int id;
-   double amount;
-   time_t unlockTimestamp;
-   bool isActive;
-   time_t releaseTimestamp;
-   string creationTimestamp;
-   string ownerUsername;
+// What loading found in one data file
+struct FileReport {
+   string name;
+   string source = "missing";  // "primary", "backup", "missing"
+   long long generation = -1;  // -1 when the file has no checkpoint header
+   size_t loaded = 0;
+   size_t unchecked = 0;
+   size_t corrupt = 0;
+   size_t malformed = 0;
+   size_t orphaned = 0;
 
+   bool clean() const { return corrupt == 0 && malformed == 0 && orphaned == 0; }
+};
 
-public:
-   // Constructor
-   LockBox(double amt, time_t uTimestamp, const string& username)
-       : amount(amt), unlockTimestamp(uTimestamp), isActive(true), ownerUsername(username) {
-       id = nextId++;
-       releaseTimestamp = 0;
-       creationTimestamp = getCurrentDateTime();
+
+// Result of loading and verifying the data files
+struct RecoveryReport {
+   vector<FileReport> files;
+   vector<string> findings;    // Problems
+   vector<string> notes;       // Informational, e.g. which checkpoint was used
+   bool manifestFound = false;
+   double seconds = 0.0;
+
+   bool clean() const {
+       if (!findings.empty()) return false;
+       for (const auto& file : files) {
+           if (!file.clean()) return false;
+       }
+       return true;
    }
 
+   void print() const {
+       cout << "\n==== DATA RECOVERY REPORT ====\n";
+       for (const auto& file : files) {
+           cout << file.name << ": " << file.source;
+           if (file.generation >= 0) cout << " (checkpoint " << file.generation << ")";
+           cout << " | loaded " << file.loaded
+               << " | unchecked " << file.unchecked
+               << " | corrupt " << file.corrupt
+               << " | malformed " << file.malformed
+               << " | orphaned " << file.orphaned << "\n";
+       }
+       if (!manifestFound) {
+           cout << "No checkpoint manifest found; totals were not verified.\n";
+       }
+       for (const auto& finding : findings) {
+           cout << "- " << finding << "\n";
+       }
+       for (const auto& note : notes) {
+           cout << "* " << note << "\n";
+       }
+       cout << (clean() ? "All checks passed" : "Problems found")
+           << " in " << fixed << setprecision(3) << seconds << "s.\n";
+   }
+};
 
-   // Constructor for loading from file
-   LockBox(int boxId, double amt, time_t uTimestamp, bool active,
-           time_t rTimestamp, const string& timestamp, const string& username)
-       : id(boxId), amount(amt), unlockTimestamp(uTimestamp), isActive(active),
-       releaseTimestamp(rTimestamp), creationTimestamp(timestamp), ownerUsername(username) {
-       if (boxId >= nextId) {
-           nextId = boxId + 1;
+
+// Records read by a load, kept in the load's scratch arena
+template <typename T>
+using RecordList = pmr::vector<shared_ptr<T>>;
+
+
+// Read one data file (primary or .bak) into records of type T. Bad lines
+// are counted and skipped instead of ending the load.
+template <typename T>
+RecordList<T> readDataFile(const string& path, FileReport& report, pmr::memory_resource* scratch) {
+   RecordList<T> records(scratch);
+   ifstream file(path);
+   if (!file.is_open()) return records;
+
+   string line;
+   bool first = true;
+   while (getline(file, line)) {
+       if (line.empty()) continue;
+       RecordStatus status = verifyRecord(line);
+       if (status == RECORD_CORRUPT) {
+           report.corrupt++;
+           continue;
+       }
+       if (first && line.rfind("#checkpoint|", 0) == 0) {
+           report.generation = atoll(line.c_str() + 12);
+           first = false;
+           continue;
+       }
+       first = false;
+       if (status == RECORD_UNCHECKED && report.generation >= 0) {
+           report.corrupt++;   // Checkpoint files always carry checksums
+           continue;
+       }
+
+       try {
+           auto record = T::parseRecord(line);
+           if (!record) {
+               report.malformed++;
+               continue;
+           }
+           if (status == RECORD_UNCHECKED) report.unchecked++;
+           records.push_back(record);
+           report.loaded++;
+       } catch (const exception&) {
+           report.malformed++;
+       }
+   }
+   return records;
+}
+
+
+// Load one data file of a checkpoint. If a crash interrupted the last
+// save, the primary file can already belong to the next checkpoint while
+// the manifest still names the previous one; the .bak copy is used then.
+template <typename T>
+RecordList<T> loadDataFile(const string& path, long long expectedGeneration,
+                           vector<FileReport>& reports, vector<string>& findings,
+                           pmr::memory_resource* scratch) {
+   FileReport primary;
+   primary.name = path;
+   RecordList<T> records = readDataFile<T>(path, primary, scratch);
+   if (filesystem::exists(path)) primary.source = "primary";
+   if (expectedGeneration < 0 || primary.generation == expectedGeneration) {
+       reports.push_back(primary);
+       return records;
+   }
+
+   FileReport backup;
+   backup.name = path;
+   RecordList<T> backupRecords = readDataFile<T>(path + ".bak", backup, scratch);
+   if (backup.generation == expectedGeneration) {
+       backup.source = "backup";
+       reports.push_back(backup);
+       return backupRecords;
+   }
+
+   if (filesystem::exists(path)) {
+       findings.push_back(path + " is from checkpoint " + to_string(primary.generation) +
+                          ", expected " + to_string(expectedGeneration));
+   }
+   reports.push_back(primary);
+   return records;
+}
+
+
+// Read the checkpoint manifest, skipping its header line
+bool loadManifest(const string& path, CheckpointTotals& totals) {
+   ifstream file(path);
+   string line;
+   while (getline(file, line)) {
+       if (verifyRecord(line) != RECORD_OK) break;
+       if (line.rfind("#checkpoint|", 0) == 0) continue;
+       return CheckpointTotals::parseRecord(line, totals);
+   }
+   return false;
+}
+
+
+// Compute the totals of a set of records
+// Totals of a user, lock box, schedule and release event list, whichever
+// container (live state or load scratch) holds them
+template <typename UserList, typename BoxList, typename ScheduleList, typename EventList>
+CheckpointTotals computeTotals(const UserList& allUsers, const BoxList& boxes,
+                               const ScheduleList& schedules, const EventList& events) {
+   CheckpointTotals totals;
+   for (const auto& user : allUsers) {
+       totals.users++;
+       totals.balanceCents += CheckpointTotals::cents(user->getBalance());
+   }
+   for (const auto& box : boxes) {
+       totals.boxes++;
+       if (box->getIsActive()) {
+           totals.activeBoxCents += CheckpointTotals::cents(box->getAmount());
+       }
+   }
+   for (const auto& schedule : schedules) {
+       totals.scheduledCents += CheckpointTotals::cents(schedule->getRemainingAmount());
+   }
+   for (const auto& event : events) {
+       totals.releases++;
+       totals.releasedCents += CheckpointTotals::cents(event->getReleasedAmount());
+   }
+   return totals;
+}
+
+
+// All records of one checkpoint, read and verified but not yet installed
+// The record lists live in the caller's scratch arena
+struct CheckpointData {
+   RecordList<User> users;
+   RecordList<LockBox> boxes;
+   RecordList<LockBoxSchedule> schedules;
+   RecordList<ReleaseEvent> events;
+   RecordList<LedgerRecord> ledger;
+   RecoveryReport report;
+   long long generation = 0;
+
+   explicit CheckpointData(pmr::memory_resource* scratch)
+       : users(scratch), boxes(scratch), schedules(scratch), events(scratch), ledger(scratch) {}
+
+   // Read the checkpoint named by the manifest with the given suffix
+   // ("" for the current checkpoint, ".bak" for the previous one)
+   static CheckpointData read(const string& suffix, pmr::memory_resource* scratch) {
+       CheckpointData data(scratch);
+       CheckpointTotals journaled;
+       data.report.manifestFound = loadManifest(CHECKPOINT_FILE + suffix, journaled);
+       long long expected = data.report.manifestFound ? journaled.generation : -1;
+       data.generation = max(0LL, expected);
+
+       vector<FileReport>& files = data.report.files;
+       vector<string>& findings = data.report.findings;
+       if (suffix.empty()) {
+           data.users = loadDataFile<User>(USERS_FILE, expected, files, findings, scratch);
+           data.boxes = loadDataFile<LockBox>(LOCKBOXES_FILE, expected, files, findings, scratch);
+           data.schedules = loadDataFile<LockBoxSchedule>(SCHEDULES_FILE, expected, files, findings, scratch);
+           data.events = loadDataFile<ReleaseEvent>(RELEASE_LOG_FILE, expected, files, findings, scratch);
+           data.ledger = loadDataFile<LedgerRecord>(LEDGER_FILE, expected, files, findings, scratch);
+       } else {
+           files.resize(5);
+           files[0].name = USERS_FILE + suffix;
+           files[1].name = LOCKBOXES_FILE + suffix;
+           files[2].name = SCHEDULES_FILE + suffix;
+           files[3].name = RELEASE_LOG_FILE + suffix;
+           files[4].name = LEDGER_FILE + suffix;
+           data.users = readDataFile<User>(files[0].name, files[0], scratch);
+           data.boxes = readDataFile<LockBox>(files[1].name, files[1], scratch);
+           data.schedules = readDataFile<LockBoxSchedule>(files[2].name, files[2], scratch);
+           data.events = readDataFile<ReleaseEvent>(files[3].name, files[3], scratch);
+           data.ledger = readDataFile<LedgerRecord>(files[4].name, files[4], scratch);
+           for (auto& file : files) {
+               file.source = "backup";
+               // Checkpoints from before the ledger existed have no ledger file
+               bool optional = &file == &files[4] && !filesystem::exists(file.name);
+               if (file.generation != expected && !optional) {
+                   findings.push_back(file.name + " does not belong to checkpoint " + to_string(expected));
+               }
+           }
+       }
+
+       // Verify totals against the ones journaled with the checkpoint
+       if (data.report.manifestFound) {
+           CheckpointTotals actual = computeTotals(data.users, data.boxes, data.schedules, data.events);
+           if (!actual.matches(journaled)) {
+               findings.push_back(
+                   "Totals differ from checkpoint " + to_string(journaled.generation) +
+                   ": users " + to_string(actual.users) + "/" + to_string(journaled.users) +
+                   ", balances " + to_string(actual.balanceCents) + "/" + to_string(journaled.balanceCents) +
+                   " cents, boxes " + to_string(actual.boxes) + "/" + to_string(journaled.boxes) +
+                   ", active boxes " + to_string(actual.activeBoxCents) + "/" +
+                   to_string(journaled.activeBoxCents) + " cents, releases " +
+                   to_string(actual.releases) + "/" + to_string(journaled.releases));
+           }
        }
+       return data;
    }
+};
 
 
-   // Accessor methods
-   int getId() const { return id; }
-   double getAmount() const { return amount; }
-   time_t getUnlockTimestamp() const { return unlockTimestamp; }
-   bool getIsActive() const { return isActive; }
-   time_t getReleaseTimestamp() const { return releaseTimestamp; }
-   string getCreationTimestamp() const { return creationTimestamp; }
-   string getOwnerUsername() const { return ownerUsername; }
+// Cross-check balances, boxes and release events, split across threads
+template <typename EventList>
+void checkConsistency(const vector<shared_ptr<User>>& allUsers, const EventList& events,
+                      RecoveryReport& report) {
+   unordered_map<long long, const ReleaseEvent*> eventsById;
+   eventsById.reserve(events.size());
+   for (const auto& event : events) {
+       eventsById.emplace(event->getLockBoxId(), event.get());
+   }
 
+   struct Counts {
+       size_t negativeBalances = 0;
+       size_t releasedWithoutEvent = 0;
+       size_t amountMismatches = 0;
+       size_t activeWithEvent = 0;
+       size_t ownerMismatches = 0;
+   };
+
+   size_t threadCount = max(1u, thread::hardware_concurrency());
+   threadCount = min(threadCount, max<size_t>(1, allUsers.size() / 1024));
+   vector<Counts> counts(threadCount);
+   vector<thread> workers;
+   for (size_t t = 0; t < threadCount; t++) {
+       workers.emplace_back([&, t]() {
+           Counts& local = counts[t];
+           for (size_t i = t; i < allUsers.size(); i += threadCount) {
+               const auto& user = allUsers[i];
+               if (user->getBalance() < 0) local.negativeBalances++;
+               for (const auto& box : user->getLockBoxes()) {
+                   if (box->getOwnerUsername() != user->getUsername()) local.ownerMismatches++;
+                   auto it = eventsById.find(box->getId());
+                   if (box->getIsActive()) {
+                       if (it != eventsById.end()) local.activeWithEvent++;
+                   } else if (it == eventsById.end()) {
+                       local.releasedWithoutEvent++;
+                   } else if (CheckpointTotals::cents(it->second->getReleasedAmount()) !=
+                              CheckpointTotals::cents(box->getAmount())) {
+                       local.amountMismatches++;
+                   }
+               }
+           }
+       });
+   }
+   for (auto& worker : workers) {
+       worker.join();
+   }
 
-   // Release the lock box
-   void release() {
-       isActive = false;
-       releaseTimestamp = time(0);
+   Counts total;
+   for (const auto& local : counts) {
+       total.negativeBalances += local.negativeBalances;
+       total.releasedWithoutEvent += local.releasedWithoutEvent;
+       total.amountMismatches += local.amountMismatches;
+       total.activeWithEvent += local.activeWithEvent;
+       total.ownerMismatches += local.ownerMismatches;
    }
 
+   if (total.negativeBalances > 0)
+       report.findings.push_back(to_string(total.negativeBalances) + " users with a negative balance");
+   if (total.amountMismatches > 0)
+       report.findings.push_back(to_string(total.amountMismatches) + " released boxes whose release event amount differs");
+   if (total.activeWithEvent > 0)
+       report.findings.push_back(to_string(total.activeWithEvent) + " active boxes that already have a release event");
+   if (total.ownerMismatches > 0)
+       report.findings.push_back(to_string(total.ownerMismatches) + " boxes assigned to the wrong user");
+   if (total.releasedWithoutEvent > 0)
+       report.notes.push_back(to_string(total.releasedWithoutEvent) +
+                              " released boxes have no release event (expected after the release log is cleared)");
+}
 
-   // Calculate seconds remaining until unlock
-   int secondsRemaining() const {
-       if (!isActive) return 0;
-       time_t now = time(0);
-       return static_cast<int>(unlockTimestamp - now);
+
+// Load the saved due index. Returns false, leaving the index empty, if
+// it is missing, damaged or from another checkpoint.
+bool loadDueIndex(const string& path, long long generation) {
+   dueIndex.clear();
+   ifstream file(path);
+   string line;
+   if (!getline(file, line) || verifyRecord(line) != RECORD_OK ||
+       line != "#checkpoint|" + to_string(generation)) {
+       return false;
+   }
+   while (getline(file, line)) {
+       if (line.empty()) continue;
+       vector<string> tokens;
+       if (verifyRecord(line) != RECORD_OK || (tokens = splitRecord(line)).size() < 3) {
+           dueIndex.clear();
+           return false;
+       }
+       dueIndex.add(atoll(tokens[1].c_str()), static_cast<time_t>(atoll(tokens[0].c_str())), tokens[2]);
    }
+   return true;
+}
 
 
-   // Check if lock box should be released
-   bool shouldRelease() const {
-       if (!isActive) return false;
-       time_t now = time(0);
-       return now >= unlockTimestamp;
+// Rebuild the due index from the loaded lock boxes and schedules
+void rebuildDueIndex() {
+   dueIndex.clear();
+   for (const auto& user : systemState.getAllUsers()) {
+       for (const auto& box : user->getLockBoxes()) {
+           if (box->getIsActive()) {
+               dueIndex.add(box->getId(), box->getUnlockTimestamp(), user->getUsername());
+           }
+       }
+       for (const auto& schedule : user->getSchedules()) {
+           if (!schedule->isComplete()) {
+               dueIndex.add(schedule->getId(), schedule->getNextUnlockTimestamp(), user->getUsername());
+           }
+       }
    }
+}
 
 
-   // Save to file stream
-   void saveToFile(ofstream& file) const {
-       file << id << "|"
-           << amount << "|"
-           << unlockTimestamp << "|"
-           << (isActive ? 1 : 0) << "|"
-           << releaseTimestamp << "|"
-           << creationTimestamp << "|"
-           << ownerUsername << endl;
+// Save all data to files as a new checkpoint
+void saveAllData() {
+   vector<shared_ptr<User>> allUsers = systemState.getAllUsers();
+   vector<shared_ptr<ReleaseEvent>> events = systemState.getReleaseLog();
+   vector<shared_ptr<LockBox>> boxes;
+   vector<shared_ptr<LockBoxSchedule>> schedules;
+   long long generation = checkpointGeneration + 1;
+
+   CheckpointWriter userFile(USERS_FILE, generation);
+   CheckpointWriter lockBoxFile(LOCKBOXES_FILE, generation);
+   CheckpointWriter scheduleFile(SCHEDULES_FILE, generation);
+   CheckpointWriter releaseFile(RELEASE_LOG_FILE, generation);
+   for (const auto& user : allUsers) {
+       userFile.write(*user);
+       for (const auto& box : user->getLockBoxes()) {
+           lockBoxFile.write(*box);
+           boxes.push_back(box);
+       }
+       for (const auto& schedule : user->getSchedules()) {
+           scheduleFile.write(*schedule);
+           schedules.push_back(schedule);
+       }
+   }
+   for (const auto& event : events) {
+       releaseFile.write(*event);
+   }
+   CheckpointWriter ledgerFile(LEDGER_FILE, generation);
+   for (const auto& user : allUsers) {
+       for (const auto& entry : user->getLedger().getEntries()) {
+           ledgerFile.write(LedgerRecord{user->getUsername(), entry.time, entry.kind,
+                                         entry.deltaCents, entry.refId});
+       }
+   }
+   CheckpointWriter dueFile(DUE_INDEX_FILE, generation);
+   for (const auto& entry : dueIndex.getEntries()) {
+       dueFile.writeLine(to_string(entry.due) + "|" + to_string(entry.id) + "|" + entry.username);
    }
 
-
-   // Static method to load from file stream
-   static shared_ptr<LockBox> loadFromFile(ifstream& file) {
-       string line;
-       if (getline(file, line)) {
-           istringstream iss(line);
-           string token;
-           vector<string> tokens;
+   CheckpointTotals totals = computeTotals(allUsers, boxes, schedules, events);
+   totals.generation = generation;
+   CheckpointWriter manifest(CHECKPOINT_FILE, generation);
+   manifest.write(totals);
+
+   // Files are written in parallel; the previous checkpoint is only
+   // replaced once every new file is complete
+   vector<future<bool>> writes;
+   for (CheckpointWriter* file : {&userFile, &lockBoxFile, &scheduleFile,
+                                  &releaseFile, &ledgerFile, &dueFile, &manifest}) {
+       writes.push_back(file->finish());
+   }
+   bool written = true;
+   for (auto& write : writes) {
+       written = write.get() && written;
+   }
+   if (!written) {
+       cout << "Error: could not write data files; previous data kept.\n";
+       return;
+   }
+   userFile.commit();
+   lockBoxFile.commit();
+   scheduleFile.commit();
+   releaseFile.commit();
+   ledgerFile.commit();
+   dueFile.commit();
+   CheckpointWriter::syncDirectory();   // Data files are in place before the manifest names them
+   manifest.commit();   // Last, so it only names a complete checkpoint
+   CheckpointWriter::syncDirectory();
+   checkpointGeneration = generation;
+
+
+   // Save lock box id high-water mark
+   LockBox::getIdAllocator().saveToFile(LOCKBOX_ID_FILE);
+}
 
 
-           while (getline(iss, token, '|')) {
-               tokens.push_back(token);
+// Load all data from files and verify it. Bad records are skipped and
+// counted instead of ending the load. In recovery mode a damaged current
+// checkpoint is replaced by the previous one if that one is intact, and a
+// full consistency check of balances, boxes and release events runs.
+RecoveryReport loadAllData(bool recoveryMode = false) {
+   auto started = chrono::steady_clock::now();
+
+   // Everything read from disk that isn't kept goes into one arena,
+   // handed back in one piece when the load returns
+   pmr::monotonic_buffer_resource scratch(64 * 1024, &memoryAccounts.loadScratch);
+   CheckpointData data = CheckpointData::read("", &scratch);
+   if (recoveryMode && !data.report.clean()) {
+       CheckpointData previous = CheckpointData::read(".bak", &scratch);
+       if (previous.report.manifestFound && previous.report.clean()) {
+           previous.report.notes.push_back(
+               "Checkpoint " + to_string(data.generation) + " is damaged; restored checkpoint " +
+               to_string(previous.generation));
+           for (const auto& file : data.report.files) {
+               if (!file.clean()) {
+                   previous.report.notes.push_back(
+                       "Damaged checkpoint: " + file.name + " had " + to_string(file.corrupt) +
+                       " corrupt, " + to_string(file.malformed) + " malformed and " +
+                       to_string(file.orphaned) + " orphaned records");
+               }
            }
+           for (const auto& finding : data.report.findings) {
+               previous.report.notes.push_back("Damaged checkpoint: " + finding);
+           }
+           data = move(previous);
+       }
+   }
+   RecoveryReport report = move(data.report);
+   checkpointGeneration = data.generation;
+   keepBackupCheckpoint = !report.clean();
 
-           if (tokens.size() >= 5) {
-               string uname = tokens[0];
-               string pass = tokens[1];
-               double balance = stod(tokens[2]);
-               bool active = stoi(tokens[3]) == 1;
-               string regDate = tokens[4];
+   // Load users
+   systemState.clearUsers();
+   for (const auto& user : data.users) {
+       if (!systemState.addUser(user->getUsername(), user, user->makeRecord())) {
+           report.files[0].malformed++;  // Duplicate username
+       }
+   }
 
 
-               return make_shared<User>(uname, pass, balance, active, regDate);
-           }
- }
-       return nullptr;
+   // The id file is written after the checkpoint and can be stale or
+   // missing, so it is only a starting point; every loaded id is observed
+   // as well. Recovery runs ignore the file.
+   if (!recoveryMode) {
+       LockBox::getIdAllocator().loadFromFile(LOCKBOX_ID_FILE);
    }
-};
-
 
-// Admin class
-class Admin : public Person {
-public:
-   // Constructor =
-   Admin(const string& uname, const string& pass)
-       : Person(uname, pass) {}
+   // Assign lockboxes to users
+   for (const auto& box : data.boxes) {
+       LockBox::getIdAllocator().observe(box->getId());
+       auto owner = systemState.findUser(box->getOwnerUsername());
+       if (owner) {
+           owner->addLockBox(box);
+       } else {
+           report.files[1].orphaned++;
+       }
+   }
 
 
-   // Constructor for loading from file 
-   Admin(const string& uname, const string& pass, const string& regDate)
-       : Person(uname, pass, regDate) {}
+   // Assign schedules to users
+   for (const auto& schedule : data.schedules) {
+       LockBox::getIdAllocator().observe(schedule->getId());
+       auto owner = systemState.findUser(schedule->getOwnerUsername());
+       if (owner) {
+           owner->addSchedule(schedule);
+       } else {
+           report.files[2].orphaned++;
+       }
+   }
 
 
-   // Display admin details 
-   void displayDetails() const override {
-       cout << "Admin Username: " << username
-           << " | Registration Date: " << registrationDate << endl;
+   // Load release log
+   systemState.clearReleaseLog();
+   for (const auto& event : data.events) {
+       systemState.appendReleaseEvent(event->getUsername(), event);
    }
 
 
-   // View all users 
-   void viewAllUsers() const {
-       cout << "\n==== ALL USERS ====\n";
-       if (users.empty()) {
-           cout << "No users registered.\n";
-           return;
+   // Restore balance ledgers. Users without ledger history (data saved
+   // before the ledger existed) start from an opening entry; a ledger that
+   // disagrees with the balance is reported and repaired the same way.
+   for (const auto& record : data.ledger) {
+       auto owner = systemState.findUser(record->username);
+       if (owner) {
+           owner->addLedgerEntry(record->toEntry());
+       } else {
+           report.files[4].orphaned++;
        }
+   }
+   size_t mismatchedLedgers = 0;
+   for (const auto& user : systemState.getAllUsers()) {
+       const BalanceLedger& ledger = user->getLedger();
+       long long difference = BalanceLedger::toCents(user->getBalance()) - ledger.getBalanceCents();
+       if (difference == 0) continue;
+       if (!ledger.getEntries().empty()) mismatchedLedgers++;
+       // Dated at registration so it opens the account's first statement
+       time_t opened;
+       if (!parseDateTime(user->getRegistrationDate(), opened)) opened = Clock::now();
+       user->insertLedgerEntry(BalanceLedger::Entry{opened, BalanceLedger::OPENING, difference, -1});
+   }
+   if (mismatchedLedgers > 0) {
+       report.findings.push_back(to_string(mismatchedLedgers) +
+                                 " ledgers did not match the balance; an opening entry was added");
+   }
 
 
-       for (const auto& user : users) {
-           user->displayDetails();
+   // The saved due index is only trusted when it belongs to this checkpoint
+   if (recoveryMode || !loadDueIndex(DUE_INDEX_FILE, data.generation)) {
+       rebuildDueIndex();
+       if (recoveryMode) {
+           report.notes.push_back("Due index rebuilt with " + to_string(dueIndex.size()) + " entries");
        }
    }
 
 
-   // Toggle user active status 
-   void toggleUserStatus(const string& username) {
-       for (auto& user : users) {
-           if (user->getUsername() == username) {
-               user->setActive(!user->isActive());
-               cout << "User " << username << " status changed to "
-                   << (user->isActive() ? "Active" : "Inactive") << endl;
-               return;
+   if (recoveryMode) {
+       checkConsistency(systemState.getAllUsers(), data.events, report);
+   }
+
+   report.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+   return report;
+}
+
+
+// Background release processing
+// Checks the due index once a second and releases whatever has come due,
+// so overdue boxes don't wait for their owner's next login. Owners see the
+// releases as notifications when they log in.
+class ReleaseScheduler {
+private:
+   thread worker;
+   mutex mtx;
+   condition_variable wakeup;
+   bool running = false;
+
+   void releaseDue() {
+       vector<DueIndex::Entry> due = dueIndex.takeDue(Clock::now());
+       sort(due.begin(), due.end(),
+           [](const auto& a, const auto& b) { return a.username < b.username; });
+
+       // One pass per owner releases all of their due boxes and installments
+       for (size_t i = 0; i < due.size(); i++) {
+           if (i > 0 && due[i].username == due[i - 1].username) continue;
+           auto user = systemState.findUser(due[i].username);
+           if (user) {
+               EventBus::Batch events(eventBus);
+               lock_guard<mutex> guard(systemState.getUserMutex(due[i].username));
+               user->checkAndReleaseLockBoxes();
            }
        }
-       cout << "User not found.\n";
-       return;
    }
 
-
-   // View release log 
-   void viewReleaseLog() const {
-       cout << "\n==== RELEASE EVENT LOG ====\n";
-       if (releaseLog.empty()) {
-           cout << "No release events have occurred.\n";
-           return;
+   void run() {
+       unique_lock<mutex> lock(mtx);
+       while (running) {
+           lock.unlock();
+           releaseDue();
+           lock.lock();
+           wakeup.wait_for(lock, chrono::seconds(1), [this] { return !running; });
        }
+   }
+
+public:
+   ~ReleaseScheduler() { stop(); }
 
+   void start() {
+       lock_guard<mutex> guard(mtx);
+       if (running) return;
+       running = true;
+       worker = thread(&ReleaseScheduler::run, this);
+   }
 
-       for (const auto& event : releaseLog) {
-           time_t released = event->getReleaseTimestamp();
-           cout << "Lock Box ID: " << event->getLockBoxId()
-               << " | User: " << event->getUsername()
-               << " | Released At: " << ctime(&released)
-               << " | Amount: $" << fixed << setprecision(2)
-               << event->getReleasedAmount() << endl;
+   // Stop before saving, so a checkpoint never sees a release half done
+   void stop() {
+       {
+           lock_guard<mutex> guard(mtx);
+           running = false;
+       }
+       wakeup.notify_all();
+       if (worker.joinable()) {
+           worker.join();
        }
    }
+};
 
+ReleaseScheduler releaseScheduler;
+
+
+// Synthetic workload settings
+// Parsed from key=value arguments, e.g.
+//   finals --workload users=10000 boxes=10000000 logins=100000 burst=0.9 out=bench/
+struct WorkloadConfig {
+    size_t userCount = 1000;
+    size_t boxCount = 100000;
+    size_t loginCount = 10000;
+    double zipfExponent = 1.0;      // Skew of user activity (0 = uniform)
+    double burstFraction = 0.5;     // Share of boxes that unlock at the burst instant
+    long long horizonSeconds = 86400;
+    unsigned long long seed = 42;
+    bool withIo = false;            // Also run log/receipt subscribers
+    string outputDir;               // Save the generated data here if set
+    string replayDir;               // Replay data saved by an earlier run instead
+
+    bool parse(const string& arg) {
+        size_t eq = arg.find('=');
+        if (eq == string::npos) return false;
+        string key = arg.substr(0, eq);
+        string value = arg.substr(eq + 1);
+        try {
+            if (key == "users") userCount = stoull(value);
+            else if (key == "boxes") boxCount = stoull(value);
+            else if (key == "logins") loginCount = stoull(value);
+            else if (key == "zipf") zipfExponent = stod(value);
+            else if (key == "burst") burstFraction = stod(value);
+            else if (key == "horizon") horizonSeconds = stoll(value);
+            else if (key == "seed") seed = stoull(value);
+            else if (key == "io") withIo = stoi(value) != 0;
+            else if (key == "out") outputDir = value;
+            else if (key == "replay") replayDir = value;
+            else return false;
+        } catch (const exception&) {
+            return false;
+        }
+        return true;
+    }
+};
 
-   // Clear release logs 
-   void clearReleaseLogs() {
-       releaseLog.clear();
-       cout << "Release logs cleared.\n";
-   }
+// Latency samples for one operation type
+class LatencyStats {
+private:
+    vector<float> samples;  // Microseconds
+
+public:
+    void record(chrono::steady_clock::duration elapsed) {
+        samples.push_back(chrono::duration<float, micro>(elapsed).count());
+    }
+
+    // Print throughput (over time spent in this operation) and latency percentiles
+    void report(const string& name) {
+        if (samples.empty()) {
+            cout << setw(10) << left << name << " no operations\n";
+            return;
+        }
+        double busySeconds = 0.0;
+        for (float sample : samples) {
+            busySeconds += sample / 1e6;
+        }
+        sort(samples.begin(), samples.end());
+        auto percentile = [this](double p) {
+            return samples[min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+        };
+        cout << setw(10) << left << name << right
+            << " ops: " << setw(10) << samples.size()
+            << " | " << fixed << setprecision(0) << setw(10) << samples.size() / max(busySeconds, 1e-9) << " ops/s"
+            << " | p50 " << setprecision(2) << percentile(0.50) << "us"
+            << " | p99 " << percentile(0.99) << "us"
+            << " | max " << samples.back() << "us\n";
+    }
 };
 
+// Deterministic synthetic workload generator and replay harness
+// Generates users, lock boxes and logins with a fixed seed, then replays
+// them against createLockBox, login and release processing on the virtual
+// clock, so a whole day of traffic runs as fast as the CPU allows.
+class WorkloadHarness {
+private:
+    enum OpType { OP_CREATE, OP_LOGIN };
+
+    struct Operation {
+        time_t time;
+        OpType type;
+        size_t user;
+        double amount;
+        time_t unlockTimestamp;
+    };
 
-// Function to register a new user 
-void registerUser() {
-   string username, password;
-   double initialBalance;
+    // One line of the saved workload file; users are named, not indexed
+    struct OperationRecord {
+        long long time;
+        OpType type;
+        string username;
+        double amount;
+        long long unlockTimestamp;
+
+        static constexpr auto recordFields() {
+            return make_tuple(&OperationRecord::time, &OperationRecord::type,
+                              &OperationRecord::username, &OperationRecord::amount,
+                              &OperationRecord::unlockTimestamp);
+        }
+    };
 
+    WorkloadConfig config;
+    mt19937_64 rng;
+    vector<double> zipfCdf;
+    vector<string> usernames;
 
-   cout << "\n==== USER REGISTRATION ====\n";
-   cout << "Enter username: ";
-   cin >> username;
+    // Pick a user index following the configured Zipf distribution
+    size_t pickUser() {
+        double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        size_t index = lower_bound(zipfCdf.begin(), zipfCdf.end(), u) - zipfCdf.begin();
+        return min(index, zipfCdf.size() - 1);
+    }
 
+    void buildZipf() {
+        zipfCdf.resize(config.userCount);
+        double total = 0.0;
+        for (size_t i = 0; i < config.userCount; i++) {
+            total += 1.0 / pow(static_cast<double>(i + 1), config.zipfExponent);
+            zipfCdf[i] = total;
+        }
+        for (auto& value : zipfCdf) {
+            value /= total;
+        }
+    }
 
-   // Check if username already exists
-   for (const auto& user : users) {
-       if (user->getUsername() == username) {
-           cout << "Username already exists. Please choose another.\n";
-           return;
-       }
-   }
+    vector<Operation> generate(time_t start) {
+        vector<Operation> ops;
+        ops.reserve(config.boxCount + config.loginCount);
+        time_t end = start + config.horizonSeconds;
+        uniform_int_distribution<long long> createTime(0, config.horizonSeconds / 2);
+        uniform_int_distribution<long long> anyTime(0, config.horizonSeconds);
+        uniform_real_distribution<double> unit(0.0, 1.0);
+        exponential_distribution<double> lockDuration(4.0 / max(config.horizonSeconds, 1LL));
+        uniform_int_distribution<int> amountCents(100, 100000);
+
+        for (size_t i = 0; i < config.boxCount; i++) {
+            Operation op;
+            op.time = start + createTime(rng);
+            op.type = OP_CREATE;
+            op.user = pickUser();
+            op.amount = amountCents(rng) / 100.0;
+            if (unit(rng) < config.burstFraction) {
+                op.unlockTimestamp = end;   // Everything due at "midnight"
+            } else {
+                op.unlockTimestamp = op.time + 1 + static_cast<time_t>(lockDuration(rng));
+            }
+            ops.push_back(op);
+        }
 
+        for (size_t i = 0; i < config.loginCount; i++) {
+            Operation op;
+            op.time = start + anyTime(rng);
+            op.type = OP_LOGIN;
+            op.user = pickUser();
+            op.amount = 0.0;
+            op.unlockTimestamp = 0;
+            ops.push_back(op);
+        }
 
-   cout << "Enter password: ";
-   cin >> password;
+        stable_sort(ops.begin(), ops.end(),
+            [](const Operation& a, const Operation& b) { return a.time < b.time; });
+        return ops;
+    }
 
+    // Release processing for one user, as done on login
+    static void processReleases(const shared_ptr<User>& user) {
+        EventBus::Batch events(eventBus);
+        lock_guard<mutex> guard(systemState.getUserMutex(user->getUsername()));
+        user->checkAndReleaseLockBoxes();
+    }
 
-   cout << "Enter initial balance: $";
-   cin >> initialBalance;
+    void addUser(const shared_ptr<User>& user) {
+        systemState.addUser(user->getUsername(), user, user->makeRecord());
+        usernames.push_back(user->getUsername());
+    }
 
+    void generateUsers() {
+        usernames.reserve(config.userCount);
+        for (size_t i = 0; i < config.userCount; i++) {
+            addUser(makeAccounted<User>("user" + to_string(i), "pw" + to_string(i), 1e12));
+        }
+    }
 
-   if (initialBalance < 0) {
-       cout << "Initial balance cannot be negative.\n";
-       return;
-   }
+    // Save the generated users and boxes in the data file formats, and
+    // every operation in replay order, before anything is replayed
+    void saveGenerated(const vector<Operation>& ops) {
+        filesystem::create_directories(config.outputDir);
+        string prefix = config.outputDir + "/";
+
+        ofstream userFile(prefix + USERS_FILE);
+        for (const auto& username : usernames) {
+            systemState.findUser(username)->saveToFile(userFile);
+        }
 
+        ofstream lockBoxFile(prefix + LOCKBOXES_FILE);
+        ofstream workloadFile(prefix + WORKLOAD_FILE);
+        long long boxId = 1;
+        string line;
+        for (const auto& op : ops) {
+            if (op.type == OP_CREATE) {
+                LockBox(boxId++, op.amount, op.unlockTimestamp, true, 0,
+                        formatDateTime(op.time), usernames[op.user]).saveToFile(lockBoxFile);
+            }
+            line.clear();
+            RecordCodec::encode(OperationRecord{op.time, op.type, usernames[op.user], op.amount,
+                                                op.unlockTimestamp}, line);
+            line += '\n';
+            workloadFile << line;
+        }
+        if (!userFile || !lockBoxFile || !workloadFile) {
+            cout << "Error: could not save the generated data to " << config.outputDir << "\n";
+            return;
+        }
+        cout << "Generated data saved to " << config.outputDir << "\n";
+    }
 
-   users.push_back(make_shared<User>(username, password, initialBalance));
+    // Read users and operations saved by saveGenerated
+    bool loadSaved(vector<Operation>& ops) {
+        string prefix = config.replayDir + "/";
+        ifstream userFile(prefix + USERS_FILE);
+        ifstream workloadFile(prefix + WORKLOAD_FILE);
+        if (!userFile || !workloadFile) {
+            cout << "No saved workload in " << config.replayDir << "\n";
+            return false;
+        }
 
+        unordered_map<string, size_t> userIndex;
+        string line;
+        while (getline(userFile, line)) {
+            auto user = User::parseRecord(line);
+            if (!user || userIndex.count(user->getUsername())) {
+                cout << "Malformed user record in " << prefix + USERS_FILE << "\n";
+                return false;
+            }
+            userIndex.emplace(user->getUsername(), usernames.size());
+            addUser(user);
+        }
 
-   // Log the transaction
-   TransactionLogger::logTransaction(
-       TransactionLogger::USER_REGISTRATION,
-       username,
-       "User registered",
-       initialBalance
-   );
+        while (getline(workloadFile, line)) {
+            auto record = RecordCodec::decode<OperationRecord>(line);
+            auto user = record ? userIndex.find(record->username) : userIndex.end();
+            if (user == userIndex.end() || (record->type != OP_CREATE && record->type != OP_LOGIN)) {
+                cout << "Malformed operation in " << prefix + WORKLOAD_FILE << "\n";
+                return false;
+            }
+            ops.push_back({static_cast<time_t>(record->time), record->type, user->second,
+                           record->amount, static_cast<time_t>(record->unlockTimestamp)});
+        }
+        config.userCount = usernames.size();
+        return true;
+    }
+
+public:
+    WorkloadHarness(const WorkloadConfig& cfg) : config(cfg), rng(cfg.seed) {}
+
+    void run() {
+        if (config.userCount == 0) {
+            cout << "Workload needs at least one user.\n";
+            return;
+        }
 
+        time_t start = 1700000000;  // Fixed origin keeps runs reproducible
+        Clock::useVirtual(start);
+        systemState.clearUsers();
+        systemState.clearReleaseLog();
 
-   cout << "User registered successfully!\n";
+        vector<Operation> ops;
+        if (!config.replayDir.empty()) {
+            if (!loadSaved(ops)) {
+                Clock::useReal();
+                return;
+            }
+            cout << "Loaded " << ops.size() << " operations for " << config.userCount
+                << " users from " << config.replayDir << "\n";
+        } else {
+            buildZipf();
+            generateUsers();
+            ops = generate(start);
+            cout << "Generated " << ops.size() << " operations for "
+                << config.userCount << " users (seed " << config.seed << ")\n";
+            if (!config.outputDir.empty()) {
+                saveGenerated(ops);
+            }
+        }
+
+        // The console is silenced during replay; per-row output would dominate
+        cout.flush();
+        cout.setstate(ios::failbit);
+
+        LatencyStats createStats, loginStats, sweepStats;
+        size_t refusedLogins = 0;
+        auto replayStart = chrono::steady_clock::now();
+        for (const auto& op : ops) {
+            Clock::advanceTo(op.time);
+            auto user = systemState.findUser(usernames[op.user]);
+            auto opStart = chrono::steady_clock::now();
+            if (op.type == OP_CREATE) {
+                EventBus::Batch events(eventBus);
+                lock_guard<mutex> guard(systemState.getUserMutex(usernames[op.user]));
+                user->createLockBox(op.amount, op.unlockTimestamp);
+                createStats.record(chrono::steady_clock::now() - opStart);
+            } else {
+                // The interactive login path: throttle, checks, login event, releases
+                if (!loginUser(usernames[op.user], user->getPassword())) {
+                    refusedLogins++;
+                }
+                currentUser = nullptr;
+                isUserLoggedIn = false;
+                loginStats.record(chrono::steady_clock::now() - opStart);
+            }
+        }
+        double replaySeconds = chrono::duration<double>(chrono::steady_clock::now() - replayStart).count();
+
+        // Burst: everyone's boxes come due at the end of the horizon
+        Clock::advanceTo(start + config.horizonSeconds);
+        auto sweepStart = chrono::steady_clock::now();
+        for (const auto& user : systemState.getAllUsers()) {
+            auto opStart = chrono::steady_clock::now();
+            processReleases(user);
+            sweepStats.record(chrono::steady_clock::now() - opStart);
+        }
+        eventBus.flush();
+        double sweepSeconds = chrono::duration<double>(chrono::steady_clock::now() - sweepStart).count();
+
+        cout.clear();
+        size_t released = systemState.getReleaseLog().size();
+        cout << "\n==== WORKLOAD REPORT ====\n";
+        cout << "Replay: " << fixed << setprecision(3) << replaySeconds << "s"
+            << " | Release sweep: " << sweepSeconds << "s"
+            << " | Boxes released: " << released
+            << " | Logins refused: " << refusedLogins << "\n";
+        createStats.report("create");
+        loginStats.report("login");
+        sweepStats.report("release");
+        for (const auto& account : memoryAccounts.getStats()) {
+            cout << setw(12) << left << account.name << right
+                << " mem: " << setw(12) << account.bytesInUse << " bytes"
+                << " | peak " << account.peakBytes << " bytes"
+                << " | " << account.liveAllocations << " blocks\n";
+        }
+        Clock::useReal();
+    }
+};
+
+// Run the workload harness from command-line arguments
+int runWorkload(int argc, char* argv[]) {
+    WorkloadConfig config;
+    for (int i = 2; i < argc; i++) {
+        if (!config.parse(argv[i])) {
+            cout << "Unknown workload option: " << argv[i] << "\n";
+            cout << "Options: users= boxes= logins= zipf= burst= horizon= seed= io=0|1 out=DIR replay=DIR\n";
+            return 1;
+        }
+    }
+
+    if (config.withIo) {
+        registerEventSubscribers();
+    }
+    eventBus.start();
+    WorkloadHarness(config).run();
+    eventBus.stop();
+    asyncWriter.stop();
+    return 0;
 }
 
 
-// Function to login a user 
-bool loginUser() {
-   string username, password;
+// Checkpoint round-trip check
+// "--selftest" saves a checkpoint holding amounts that don't survive
+// short decimal formatting (12345.67, 0.1 + 0.2, large balances), loads
+// it back in a scratch directory and fails if any amount, total or
+// ledger changed on the way.
+int runSelfTest() {
+    const double amounts[] = {12345.67, 0.1 + 0.2, 1e9 + 0.01, 99999999.99, 0.01, 1234567.89, 1.005};
+    filesystem::path original = filesystem::current_path();
+    filesystem::path directory = filesystem::temp_directory_path() /
+        ("lockbox_selftest_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+    filesystem::create_directories(directory);
+    filesystem::current_path(directory);
+
+    systemState.clearUsers();
+    systemState.clearReleaseLog();
+    long long nextId = 1;
+    for (size_t i = 0; i < size(amounts); i++) {
+        string uname = "selftest" + to_string(i);
+        auto user = makeAccounted<User>(uname, "pw", amounts[i]);
+        systemState.addUser(uname, user, user->makeRecord());
+        double boxAmount = amounts[(i + 1) % size(amounts)];
+        user->addLockBox(makeAccounted<LockBox>(nextId++, boxAmount, Clock::now() + 3600, true,
+                                                 0, getCurrentDateTime(), uname));
+        double releasedAmount = amounts[(i + 2) % size(amounts)];
+        user->addLockBox(makeAccounted<LockBox>(nextId, releasedAmount, Clock::now() - 60, false,
+                                                 Clock::now(), getCurrentDateTime(), uname));
+        systemState.appendReleaseEvent(uname, makeAccounted<ReleaseEvent>(nextId++, Clock::now(),
+                                                                          releasedAmount, uname));
+    }
 
+    vector<string> failures;
+    for (int round = 1; round <= 2; round++) {
+        vector<pair<double, vector<double>>> expected;
+        for (const auto& user : systemState.getAllUsers()) {
+            vector<double> boxes;
+            for (const auto& box : user->getLockBoxes()) {
+                boxes.push_back(box->getAmount());
+            }
+            expected.emplace_back(user->getBalance(), boxes);
+        }
+        vector<double> expectedReleases;
+        for (const auto& event : systemState.getReleaseLog()) {
+            expectedReleases.push_back(event->getReleasedAmount());
+        }
 
-   cout << "\n==== USER LOGIN ====\n";
-   cout << "Enter username: ";
-   cin >> username;
-   cout << "Enter password: ";
-   cin >> password;
+        saveAllData();
+        RecoveryReport report = loadAllData();
+        if (!report.clean()) {
+            failures.push_back("round " + to_string(round) + ": load reported problems");
+            report.print();
+        }
 
+        auto users = systemState.getAllUsers();
+        bool same = users.size() == expected.size();
+        for (size_t i = 0; same && i < users.size(); i++) {
+            same = users[i]->getBalance() == expected[i].first &&
+                users[i]->getLockBoxes().size() == expected[i].second.size();
+            for (size_t j = 0; same && j < expected[i].second.size(); j++) {
+                same = users[i]->getLockBoxes()[j]->getAmount() == expected[i].second[j];
+            }
+        }
+        auto events = systemState.getReleaseLog();
+        same = same && events.size() == expectedReleases.size();
+        for (size_t i = 0; same && i < events.size(); i++) {
+            same = events[i]->getReleasedAmount() == expectedReleases[i];
+        }
+        if (!same) {
+            failures.push_back("round " + to_string(round) + ": amounts changed after reload");
+        }
+    }
 
-   for (auto& user : users) {
-       if (user->getUsername() == username) {
-           if (!user->isActive()) {
-               cout << "This account is inactive. Please contact the admin.\n";
-               return false;
-           }
+    systemState.clearUsers();
+    systemState.clearReleaseLog();
+    filesystem::current_path(original);
+    error_code ec;
+    filesystem::remove_all(directory, ec);
 
+    for (const auto& failure : failures) {
+        cout << "FAIL " << failure << "\n";
+    }
+    cout << (failures.empty() ? "Checkpoint round trip passed.\n" : "Checkpoint round trip failed.\n");
+    return failures.empty() ? 0 : 1;
+}
 
-           if (user->checkPassword(password)) {
-               currentUser = user;
-               isUserLoggedIn = true;
 
+// Partitioned deployment
+// "--partitions N" starts N worker processes. Each owns the users whose
+// username hashes to it, together with their lock boxes, schedules and
+// release events, and keeps its own data files in partition_<i>/. The
+// router process only runs the menus: user sessions are forwarded to the
+// owning worker, admin listings are gathered from every worker.
 
-               // Log the transaction
-               TransactionLogger::logTransaction(
-                   TransactionLogger::USER_LOGIN,
-                   username,
-                   "User login"
-               );
+// Owning partition of a username
+size_t partitionFor(const string& username, size_t partitionCount) {
+   return fnv1a(username) % partitionCount;
+}
 
 
-               cout << "Login successful! Welcome, " << username << "!\n";
-               currentUser->checkAndReleaseLockBoxes(); // Check for unlockable boxes on login
-               return true;
-           } else {
-               cout << "Incorrect password.\n";
-               return false;
-           }
-       }
-   }
+#ifdef PARTITIONS_SUPPORTED
 
+// Control bytes on the router <-> worker socket
+const char PARTITION_INPUT = '\x05';   // Worker is waiting for a line of console input
+const char PARTITION_DONE = '\x04';    // Worker finished the current command
+const char PARTITION_EOF = '\x18';     // Router's console input has ended
 
-   cout << "User not found.\n";
-   return false;
+
+// Write a whole buffer to a socket, retrying short writes
+bool writeAll(int fd, const char* data, size_t size) {
+   while (size > 0) {
+       ssize_t written = ::write(fd, data, size);
+       if (written < 0 && errno == EINTR) continue;
+       if (written <= 0) return false;
+       data += written;
+       size -= static_cast<size_t>(written);
+   }
+   return true;
 }
 
 
-// Function to login admin 
-bool loginAdmin() {
-   string username, password;
+// Worker side of the router socket, installed as the buffer of cin and
+// cout. Output is passed through; reading asks the router for the next
+// console line, so the existing menus run unchanged inside a worker.
+class PartitionChannel : public streambuf {
+private:
+   int fd;
+   char output[4096];
+   string input;       // Console line currently being read
+   string received;    // Bytes read from the socket but not yet used
+
+   bool readLine(string& line) {
+       size_t end;
+       while ((end = received.find('\n')) == string::npos) {
+           char chunk[4096];
+           ssize_t count = ::read(fd, chunk, sizeof(chunk));
+           if (count < 0 && errno == EINTR) continue;
+           if (count <= 0) return false;
+           received.append(chunk, static_cast<size_t>(count));
+       }
+       line = received.substr(0, end);
+       received.erase(0, end + 1);
+       return true;
+   }
+
+protected:
+   int overflow(int c) override {
+       if (sync() != 0) return traits_type::eof();
+       if (!traits_type::eq_int_type(c, traits_type::eof())) {
+           *pptr() = traits_type::to_char_type(c);
+           pbump(1);
+       }
+       return traits_type::not_eof(c);
+   }
 
+   int sync() override {
+       bool written = writeAll(fd, pbase(), static_cast<size_t>(pptr() - pbase()));
+       setp(output, output + sizeof(output));
+       return written ? 0 : -1;
+   }
 
-   cout << "\n==== ADMIN LOGIN ====\n";
-   cout << "Enter admin username: ";
-   cin >> username;
-   cout << "Enter admin password: ";
-   cin >> password;
+   int underflow() override {
+       if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+       sync();
+       if (!writeAll(fd, &PARTITION_INPUT, 1) || !readLine(input) ||
+           (!input.empty() && input[0] == PARTITION_EOF)) {
+           return traits_type::eof();
+       }
+       input += '\n';
+       setg(&input[0], &input[0], &input[0] + input.size());
+       return traits_type::to_int_type(*gptr());
+   }
 
+public:
+   PartitionChannel(int socket) : fd(socket) {
+       setp(output, output + sizeof(output));
+   }
 
-   if (systemAdmin->getUsername() == username && systemAdmin->checkPassword(password)) {
-       isAdminLoggedIn = true;
+   // Next command from the router. Unread console input belongs to the
+   // previous command and is dropped.
+   bool readCommand(string& command) {
+       setg(nullptr, nullptr, nullptr);
+       return readLine(command);
+   }
 
+   // Tell the router the current command is complete
+   void endCommand() {
+       sync();
+       writeAll(fd, &PARTITION_DONE, 1);
+   }
+};
 
-       // Log the transaction
-       TransactionLogger::logTransaction(
-           TransactionLogger::ADMIN_LOGIN,
-           username,
-           "Admin login"
-       );
 
+// Body of one worker process
+int runPartitionWorker(int fd, size_t index, bool recoveryMode) {
+   PartitionChannel channel(fd);
+   cin.rdbuf(&channel);
+   cout.rdbuf(&channel);
 
-       cout << "Admin login successful!\n";
-       return true;
+   string directory = "partition_" + to_string(index);
+   error_code ec;
+   filesystem::create_directories(directory, ec);
+   if (chdir(directory.c_str()) != 0) {
+       cout << "Error: cannot open partition directory " << directory << ".\n";
+       channel.endCommand();
+       return 1;
    }
 
+   receiptLayout.prepare();
+   registerEventSubscribers();
+   transactionIndex.loadHistory();
+   eventBus.start();
+   RecoveryReport report = loadAllData(recoveryMode);
+   bool healthy = recoveryMode || report.clean();
+   if (recoveryMode) {
+       cout << "\n[Partition " << index << "]";
+       report.print();
+   } else if (!healthy) {
+       cout << "Error: partition " << index << " found problems while loading data. "
+           << "Restart with --recover to review and repair them.\n";
+   }
+   // Give each partition its own id range so gathered listings stay unambiguous
+   LockBox::getIdAllocator().observe(static_cast<long long>(index) << 40);
+   systemAdmin = make_shared<Admin>("admin", "admin123");
+   loginThrottle.setUnknownUserAccount(systemAdmin->getUsername());
+   channel.endCommand();
+   if (!healthy) {
+       eventBus.stop();
+       asyncWriter.stop();
+       transactionIndex.stop();
+       return 1;
+   }
+   releaseScheduler.start();
 
-   cout << "Invalid admin credentials.\n";
-   return false;
-}
-
-// Display user menu
-void displayUserMenu() {
-   cout << "\n==== USER MENU ====\n";
-   cout << "1. Create Lock Box\n";
-   cout << "2. View Active Lock Boxes\n";
-   cout << "3. View Released Lock Boxes\n";
-   cout << "4. View All Lock Boxes\n";
-   cout << "5. Check Balance\n";
-   cout << "6. Logout\n";
-   cout << "Enter your choice: ";
-}
 
+   string command;
+   while (channel.readCommand(command)) {
+       istringstream request(command);
+       string name, username;
+       request >> name >> username;
 
-// Display admin menu 
-void displayAdminMenu() {
-   cout << "\n==== ADMIN MENU ====\n";
-   cout << "1. View All Users\n";
-   cout << "2. Toggle User Status (Activate/Deactivate)\n";
-   cout << "3. View Release Log\n";
-   cout << "4. Clear Release Logs\n";
-   cout << "5. Logout\n";
-   cout << "Enter your choice: ";
-}
+       if (name == "register") {
+           registerUser(username);
+       } else if (name == "login") {
+           if (loginUser(username)) {
+               while (isUserLoggedIn && cin) {
+                   processUserMenu();
+               }
+           }
+       } else if (name == "toggle") {
+           systemAdmin->toggleUserStatus(username);
+       } else if (name == "users" || name == "releases") {
+           ostringstream records;
+           if (name == "users") {
+               for (const auto& record : systemState.takeSnapshot().users) {
+                   record->saveToFile(records);
+               }
+           } else {
+               for (const auto& event : systemState.getReleaseLog()) {
+                   event->saveToFile(records);
+               }
+           }
+           cout << records.str();
+       } else if (name == "clear-releases") {
+           systemState.clearReleaseLog();
+       } else if (name == "search") {
+           // The encoded query is the rest of the command; fields may be empty
+           auto query = RecordCodec::decode<TransactionIndex::Query>(
+               string_view(command).substr(min(command.size(), name.size() + 1)));
+           if (query) {
+               string records;
+               for (const auto& entry : transactionIndex.search(*query)) {
+                   RecordCodec::encode(entry, records);
+                   records += '\n';
+               }
+               cout << records;
+           }
+       } else if (name == "memory") {
+           string records;
+           for (auto account : memoryAccounts.getStats()) {
+               account.name = "partition_" + to_string(index) + "/" + account.name;
+               RecordCodec::encode(account, records);
+               records += '\n';
+           }
+           cout << records;
+       } else if (name == "exit") {
+           break;
+       }
+       cin.clear();
+       channel.endCommand();
+   }
 
 
-// Display main menu 
-void displayMainMenu() {
-   cout << "\n==== TIME-LOCKED SAVINGS SYSTEM ====\n";
-   cout << "1. Register User\n";
-   cout << "2. User Login\n";
-   cout << "3. Admin Login\n";
-   cout << "4. Exit\n";
-   cout << "Enter your choice: ";
+   releaseScheduler.stop();
+   saveAllData();
+   saveMemoryStats(memoryAccounts.getStats());
+   loginThrottle.flushFailures();
+   eventBus.stop();
+   asyncWriter.stop();
+   transactionIndex.stop();
+   channel.endCommand();
+   return 0;
 }
 
 
-// Process user menu 
-void processUserMenu() {
-   int choice;
-   displayUserMenu();
-   cin >> choice;
+// Router side: starts the workers and talks to them over socket pairs
+class PartitionRouter {
+private:
+   struct Worker {
+       pid_t pid = -1;
+       int fd = -1;
+       string received;
+       bool alive = false;
+   };
+   vector<Worker> workers;
+
+   // Next byte from a worker, or -1 once it has gone away
+   int readByte(Worker& worker) {
+       if (worker.received.empty()) {
+           char chunk[4096];
+           ssize_t count;
+           do {
+               count = ::read(worker.fd, chunk, sizeof(chunk));
+           } while (count < 0 && errno == EINTR);
+           if (count <= 0) {
+               worker.alive = false;
+               return -1;
+           }
+           worker.received.assign(chunk, static_cast<size_t>(count));
+           reverse(worker.received.begin(), worker.received.end());
+       }
+       unsigned char c = static_cast<unsigned char>(worker.received.back());
+       worker.received.pop_back();
+       return c;
+   }
 
+   // Forward one console line, or the end of input, to a worker
+   void sendInput(Worker& worker) {
+       string line;
+       if (!getline(cin, line)) {
+           line = string(1, PARTITION_EOF);
+       }
+       line += '\n';
+       worker.alive = writeAll(worker.fd, line.data(), line.size());
+   }
 
-   switch (choice) {
-       case 1: {
-           // Create Lock Box
-           double amount;
-           int seconds;
+   // Read a worker's reply until it finishes the command. Replies are
+   // printed when console is set; console input is forwarded on request.
+   bool receive(Worker& worker, string* reply, bool console) {
+       string text;
+       while (worker.alive) {
+           int c = readByte(worker);
+           if (c < 0) break;
+           if (c == PARTITION_DONE || c == PARTITION_INPUT) {
+               if (console) {
+                   cout << text;
+                   cout.flush();
+               } else if (reply) {
+                   *reply += text;
+               }
+               text.clear();
+               if (c == PARTITION_DONE) return true;
+               if (console) {
+                   sendInput(worker);
+               } else {
+                   string end = string(1, PARTITION_EOF) + "\n";
+                   worker.alive = writeAll(worker.fd, end.data(), end.size());
+               }
+               continue;
+           }
+           text += static_cast<char>(c);
+       }
+       if (console) cout << text;
+       return false;
+   }
 
+   bool send(Worker& worker, const string& command) {
+       string line = command + "\n";
+       if (worker.alive) {
+           worker.alive = writeAll(worker.fd, line.data(), line.size());
+       }
+       return worker.alive;
+   }
 
-           cout << "Enter amount to lock: $";
-           cin >> amount;
+public:
+   // Fork the workers. Returns false if any of them failed to load.
+   bool start(size_t count, bool recoveryMode) {
+       signal(SIGPIPE, SIG_IGN);   // A dead worker shows up as a failed write instead
+       cout.flush();
+       for (size_t i = 0; i < count; i++) {
+           int sockets[2];
+           if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+               cout << "Error: cannot create partition socket.\n";
+               return false;
+           }
+           pid_t pid = fork();
+           if (pid == 0) {
+               close(sockets[0]);
+               for (const auto& worker : workers) {
+                   close(worker.fd);
+               }
+               int status = runPartitionWorker(sockets[1], i, recoveryMode);
+               cout.flush();
+               _exit(status);
+           }
+           close(sockets[1]);
+           Worker worker;
+           worker.pid = pid;
+           worker.fd = sockets[0];
+           worker.alive = pid > 0;
+           workers.push_back(worker);
+       }
 
+       // Each worker reports once its data is loaded
+       bool healthy = true;
+       for (auto& worker : workers) {
+           healthy = receive(worker, nullptr, true) && healthy;
+       }
+       return healthy;
+   }
 
-           cout << "Enter lock duration in seconds: ";
-           cin >> seconds;
+   size_t ownerOf(const string& username) const {
+       return partitionFor(username, workers.size());
+   }
 
+   // Run an interactive command on one partition
+   void forward(size_t partition, const string& command) {
+       Worker& worker = workers[partition];
+       if (!send(worker, command) || !receive(worker, nullptr, true)) {
+           cout << "\nPartition " << partition << " is not responding.\n";
+       }
+   }
 
-           if (seconds <= 0) {
-               cout << "Invalid duration. Please enter a positive number of seconds.\n";
-               break;
+   // Run a command on every partition and collect the reply lines
+   vector<string> gather(const string& command) {
+       for (auto& worker : workers) {
+           send(worker, command);
+       }
+       vector<string> lines;
+       for (size_t i = 0; i < workers.size(); i++) {
+           string reply;
+           if (!receive(workers[i], &reply, false)) {
+               cout << "Warning: partition " << i << " is not responding; results are incomplete.\n";
+               continue;
+           }
+           istringstream stream(reply);
+           string line;
+           while (getline(stream, line)) {
+               if (!line.empty()) lines.push_back(line);
            }
+       }
+       return lines;
+   }
 
+   vector<shared_ptr<const UserRecord>> gatherUsers() {
+       vector<shared_ptr<const UserRecord>> users;
+       for (const auto& line : gather("users")) {
+           auto record = UserRecord::parseRecord(line);
+           if (record) users.push_back(record);
+       }
+       sort(users.begin(), users.end(), [](const auto& a, const auto& b) {
+           return a->username < b->username;
+       });
+       return users;
+   }
 
-           time_t now = time(0);
-           time_t unlockTimestamp = now + seconds;
-           currentUser->createLockBox(amount, unlockTimestamp);
-           break;
+   vector<shared_ptr<ReleaseEvent>> gatherReleaseLog() {
+       vector<shared_ptr<ReleaseEvent>> events;
+       for (const auto& line : gather("releases")) {
+           auto event = ReleaseEvent::parseRecord(line);
+           if (event) events.push_back(event);
        }
-       case 2:
-           // View Active Lock Boxes
-           currentUser->viewLockBoxes(true, false);
-           break;
-       case 3:
-           // View Released Lock Boxes
-           currentUser->viewLockBoxes(false, true);
-           break;
-       case 4:
-           // View All Lock Boxes
-           currentUser->viewLockBoxes(true, true);
-           break;
-       case 5:
-           // Check Balance
-           cout << "Current balance: $" << fixed << setprecision(2)
-               << currentUser->getBalance() << endl;
-           break;
-       case 6:
-           // Logout
-           cout << "Logging out...\n";
-           // Log the transaction
-           TransactionLogger::logTransaction(
-               TransactionLogger::USER_LOGOUT,
-               currentUser->getUsername(),
-               "User logout"
-           );
-           currentUser = nullptr;
-           isUserLoggedIn = false;
-           break;
-       default:
-           cout << "Invalid choice. Please try again.\n";
-           break;
+       stable_sort(events.begin(), events.end(), [](const auto& a, const auto& b) {
+           return a->getReleaseTimestamp() < b->getReleaseTimestamp();
+       });
+       return events;
    }
-}
 
-// Save all data to files 
-void saveAllData() {
-   // Save users
-   ofstream userFile(USERS_FILE);
-   for (const auto& user : users) {
-       user->saveToFile(userFile);
+   // Run a transaction search on every worker and on the router's own
+   // log (admin sessions), merged in time order
+   vector<TransactionIndex::Entry> searchTransactions(const TransactionIndex::Query& query) {
+       vector<TransactionIndex::Entry> entries = transactionIndex.search(query);
+       string command = "search ";
+       RecordCodec::encode(query, command);
+       for (const auto& line : gather(command)) {
+           auto entry = RecordCodec::decode<TransactionIndex::Entry>(line);
+           if (entry) entries.push_back(*entry);
+       }
+       stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+           return a.time < b.time;
+       });
+       return entries;
    }
-   userFile.close();
 
+   // Memory statistics of every worker, named by partition
+   vector<MemoryAccount::Stats> gatherMemoryStats() {
+       vector<MemoryAccount::Stats> stats;
+       for (const auto& line : gather("memory")) {
+           auto account = RecordCodec::decode<MemoryAccount::Stats>(line);
+           if (account) stats.push_back(*account);
+       }
+       return stats;
+   }
 
-   // Save lockboxes
-   ofstream lockBoxFile(LOCKBOXES_FILE);
-   for (const auto& user : users) {
-       for (const auto& box : user->getLockBoxes()) {
-           box->saveToFile(lockBoxFile);
+   // Ask every worker to save and exit, then wait for them
+   void stop() {
+       for (auto& worker : workers) {
+           if (send(worker, "exit")) {
+               receive(worker, nullptr, true);
+           }
+           close(worker.fd);
+           if (worker.pid > 0) {
+               waitpid(worker.pid, nullptr, 0);
+           }
        }
+       workers.clear();
    }
-   lockBoxFile.close();
+};
 
+#endif
 
-   // Save release log
-   ofstream releaseFile(RELEASE_LOG_FILE);
-   for (const auto& event : releaseLog) {
-       event->saveToFile(releaseFile);
+
+// Run the menus against N partition worker processes
+int runPartitioned(int argc, char* argv[]) {
+#ifdef PARTITIONS_SUPPORTED
+   long long count = argc > 2 ? atoll(argv[2]) : 0;
+   bool recoveryMode = argc > 3 && string(argv[3]) == "--recover";
+   if (count < 1 || count > 64) {
+       cout << "Usage: " << argv[0] << " --partitions <1-64> [--recover]\n";
+       return 1;
    }
-   releaseFile.close();
-}
 
+   // Users are placed by hash, so the partition count can't change later
+   long long existing = 0;
+   ifstream countFile(PARTITIONS_FILE);
+   if (countFile >> existing && existing != count) {
+       cout << "Error: data is split into " << existing << " partitions; start with --partitions "
+           << existing << ".\n";
+       return 1;
+   }
+   countFile.close();
+   ofstream(PARTITIONS_FILE) << count << endl;
 
-// Load all data from files
-void loadAllData() {
-   // Load users
-   users.clear();
-   ifstream userFile(USERS_FILE);
-   if (userFile.is_open()) {
-       while (true) {
-           auto user = User::loadFromFile(userFile);
-           if (!user) break;
-           users.push_back(user);
-       }
-       userFile.close();
-   }
-
-
-   // Load lockboxes and assign to users
-   ifstream lockBoxFile(LOCKBOXES_FILE);
-   if (lockBoxFile.is_open()) {
-       while (true) {
-           auto box = LockBox::loadFromFile(lockBoxFile);
-           if (!box) break;
-           // Assign lockbox to the correct user
-           for (auto& user : users) {
-               if (user->getUsername() == box->getOwnerUsername()) {
-                   user->addLockBox(box);
-                   break;
-               }
-           }
-       }
-       lockBoxFile.close();
+   PartitionRouter router;
+   if (!router.start(static_cast<size_t>(count), recoveryMode)) {
+       router.stop();
+       return 1;
    }
+   receiptLayout.prepare();
+   registerEventSubscribers();
+   transactionIndex.loadHistory();
+   eventBus.start();
+   systemAdmin = make_shared<Admin>("admin", "admin123");
+   loginThrottle.setUnknownUserAccount(systemAdmin->getUsername());
 
 
-   // Load release log
-   releaseLog.clear();
-   ifstream releaseFile(RELEASE_LOG_FILE);
-   if (releaseFile.is_open()) {
-       while (true) {
-           auto event = ReleaseEvent::loadFromFile(releaseFile);
-           if (!event) break;
-           releaseLog.push_back(event);
+   int choice;
+   do {
+       displayMainMenu();
+       cin >> choice;
+       if (!cin) break;
+
+
+       string username;
+       switch (choice) {
+           case 1:
+               cout << "\n==== USER REGISTRATION ====\n";
+               cout << "Enter username: ";
+               cin >> username;
+               router.forward(router.ownerOf(username), "register " + username);
+               break;
+           case 2:
+               cout << "\n==== USER LOGIN ====\n";
+               cout << "Enter username: ";
+               cin >> username;
+               router.forward(router.ownerOf(username), "login " + username);
+               break;
+           case 3:
+               if (loginAdmin()) {
+                   int adminChoice;
+                   do {
+                       displayAdminMenu();
+                       cin >> adminChoice;
+                       if (!cin) break;
+
+
+                       switch (adminChoice) {
+                           case 1: {
+                               size_t pageSize = readPageSize();
+                               systemAdmin->viewAllUsers(router.gatherUsers(), pageSize);
+                               break;
+                           }
+                           case 2:
+                               cout << "Enter username to toggle status: ";
+                               cin >> username;
+                               router.forward(router.ownerOf(username), "toggle " + username);
+                               break;
+                           case 3: {
+                               size_t pageSize = readPageSize();
+                               systemAdmin->viewReleaseLog(router.gatherReleaseLog(), pageSize);
+                               break;
+                           }
+                           case 4:
+                               router.gather("clear-releases");
+                               cout << "Release logs cleared.\n";
+                               break;
+                           case 5: {
+                               TransactionIndex::Query query;
+                               if (!readTransactionQuery(query)) break;
+                               size_t pageSize = readPageSize();
+                               auto started = chrono::steady_clock::now();
+                               auto results = router.searchTransactions(query);
+                               chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - started;
+                               systemAdmin->viewTransactions(results, pageSize, elapsed.count());
+                               break;
+                           }
+                           case 6: {
+                               auto stats = router.gatherMemoryStats();
+                               saveMemoryStats(stats);
+                               systemAdmin->viewMemoryUsage(stats);
+                               break;
+                           }
+                           case 7:
+                               cout << "Logging out...\n";
+                               eventBus.publish(SystemEvent(
+                                   TransactionLogger::ADMIN_LOGOUT,
+                                   systemAdmin->getUsername(),
+                                   "Admin logout"
+                               ));
+                               isAdminLoggedIn = false;
+                               break;
+                           default:
+                               cout << "Invalid choice. Please try again.\n";
+                               break;
+                       }
+                   } while (isAdminLoggedIn);
+               }
+               break;
+           case 4:
+               cout << "Exiting the system. Goodbye!\n";
+               break;
+           default:
+               cout << "Invalid choice. Please try again.\n";
+               break;
        }
-       releaseFile.close();
-   }
+   } while (choice != 4);
+
+
+   router.stop();   // Workers save their own data
+   loginThrottle.flushFailures();
+   eventBus.stop();
+   asyncWriter.stop();
+   transactionIndex.stop();
+   return 0;
+#else
+   cout << "Partitioned mode is not supported on this platform.\n";
+   return 1;
+#endif
 }
 
 
 // Main function
-int main() {
-   loadAllData();
+int main(int argc, char* argv[]) {
+   // --memory=heap|pool can go with any mode; take it out before choosing one
+   for (int i = 1; i < argc; i++) {
+       string arg = argv[i];
+       if (arg.rfind("--memory=", 0) != 0) continue;
+       MemoryAccounts::Mode mode;
+       if (!MemoryAccounts::parseMode(arg.substr(9), mode) || !memoryAccounts.configure(mode)) {
+           cout << "Usage: " << argv[0] << " [--memory=heap|pool] [--recover | --partitions N | --workload ... | --selftest]\n";
+           return 1;
+       }
+       for (int j = i; j < argc; j++) {
+           argv[j] = argv[j + 1];
+       }
+       argc--;
+       i--;
+   }
+   if (argc > 1 && string(argv[1]) == "--workload") {
+       return runWorkload(argc, argv);
+   }
+   if (argc > 1 && string(argv[1]) == "--selftest") {
+       return runSelfTest();
+   }
+   if (argc > 1 && string(argv[1]) == "--partitions") {
+       return runPartitioned(argc, argv);
+   }
+
+   bool recoveryMode = argc > 1 && string(argv[1]) == "--recover";
+
+   receiptLayout.prepare();
+   registerEventSubscribers();
+   transactionIndex.loadHistory();
+   eventBus.start();
+   RecoveryReport report = loadAllData(recoveryMode);
+   if (recoveryMode) {
+       report.print();
+   } else if (!report.clean()) {
+       // Saving now would replace the damaged checkpoint with partial data
+       cout << "Error: problems were found while loading data. "
+           << "Restart with --recover to review and repair them.\n";
+       eventBus.stop();
+       asyncWriter.stop();
+       transactionIndex.stop();
+       return 1;
+   }
+   releaseScheduler.start();   // Only once the checkpoint has been verified
    // Initialize the system admin
    systemAdmin = make_shared<Admin>("admin", "admin123");
+   loginThrottle.setUnknownUserAccount(systemAdmin->getUsername());
 
 
    int choice;
@@ -921,7 +5442,7 @@ int main() {
 
                        switch (adminChoice) {
                            case 1:
-                               systemAdmin->viewAllUsers();
+                               systemAdmin->viewAllUsers(readPageSize());
                                break;
                            case 2: {
                                string username;
@@ -931,19 +5452,35 @@ int main() {
                                break;
                            }
                            case 3:
-                               systemAdmin->viewReleaseLog();
+                               systemAdmin->viewReleaseLog(readPageSize());
                                break;
                            case 4:
                                systemAdmin->clearReleaseLogs();
                                break;
-                           case 5:
+                           case 5: {
+                               TransactionIndex::Query query;
+                               if (!readTransactionQuery(query)) break;
+                               size_t pageSize = readPageSize();
+                               auto started = chrono::steady_clock::now();
+                               auto results = transactionIndex.search(query);
+                               chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - started;
+                               systemAdmin->viewTransactions(results, pageSize, elapsed.count());
+                               break;
+                           }
+                           case 6: {
+                               auto stats = memoryAccounts.getStats();
+                               saveMemoryStats(stats);
+                               systemAdmin->viewMemoryUsage(stats);
+                               break;
+                           }
+                           case 7:
                                cout << "Logging out...\n";
                                // Log the transaction
-                               TransactionLogger::logTransaction(
+                               eventBus.publish(SystemEvent(
                                    TransactionLogger::ADMIN_LOGOUT,
                                    systemAdmin->getUsername(),
                                    "Admin logout"
-                               );
+                               ));
                                isAdminLoggedIn = false;
                                break;
                            default:
@@ -955,7 +5492,6 @@ int main() {
                break;
            case 4:
                cout << "Exiting the system. Goodbye!\n";
-               saveAllData();
                break;
            default:
                cout << "Invalid choice. Please try again.\n";
@@ -964,12 +5500,18 @@ int main() {
    } while (choice != 4);
 
 
+   releaseScheduler.stop();
    saveAllData(); // Save everything before exiting
+   saveMemoryStats(memoryAccounts.getStats());
+   loginThrottle.flushFailures();
+   eventBus.stop(); // Deliver any queued log and receipt writes
+   asyncWriter.stop();
+   transactionIndex.stop();
    return 0;
 }
 
            if (tokens.size() >= 7) {
-               int id = stoi(tokens[0]);
+               long long id = stoll(tokens[0]);
                double amount = stod(tokens[1]);
                time_t unlockTimestamp = static_cast<time_t>(stoll(tokens[2]));
                bool active = stoi(tokens[3]) == 1;
@@ -986,13 +5528,33 @@ int main() {
 };
 
 
-int LockBox::nextId = 1; // Static member initialization
+atomic<long long> IdAllocator::generations(0);
+IdAllocator LockBox::idAllocator(1); // Static member initialization
+
+
+// Schedules take their ids from the lock box id space
+LockBoxSchedule::LockBoxSchedule(Kind k, double amount, time_t first, long long interval,
+                                 int count, const string& username)
+    : id(LockBox::getIdAllocator().allocate()), kind(k), firstUnlock(first),
+    intervalSeconds(interval), installmentCount(count), releasedCount(0),
+    ownerUsername(username) {
+    long long amountCents = llround(amount * 100.0);
+    if (kind == LADDERED) {
+        long long rungCents = amountCents / count;
+        installmentAmount = rungCents / 100.0;
+        finalAmount = (amountCents - rungCents * (count - 1)) / 100.0;
+    } else {
+        installmentAmount = amountCents / 100.0;
+        finalAmount = installmentAmount;
+    }
+    creationTimestamp = getCurrentDateTime();
+}
 
 
 // ReleaseEvent class
 class ReleaseEvent {
 private:
-   int lockBoxId;
+   long long lockBoxId;
    time_t releaseTimestamp;
    double releasedAmount;
    string username;
@@ -1001,60 +5563,53 @@ private:
 
 public:
    // Constructor
-   ReleaseEvent(int lbId, time_t rTimestamp, double amount, const string& uname)
+   ReleaseEvent(long long lbId, time_t rTimestamp, double amount, const string& uname)
        : lockBoxId(lbId), releaseTimestamp(rTimestamp), releasedAmount(amount), username(uname) {
        timestamp = getCurrentDateTime();
    }
 
 
    // Constructor for loading from file
-   ReleaseEvent(int lbId, time_t rTimestamp, double amount, const string& uname, const string& ts)
+   ReleaseEvent(long long lbId, time_t rTimestamp, double amount, const string& uname, const string& ts)
        : lockBoxId(lbId), releaseTimestamp(rTimestamp), releasedAmount(amount), username(uname), timestamp(ts) {}
 
 
    // Accessor methods
-   int getLockBoxId() const { return lockBoxId; }
+   long long getLockBoxId() const { return lockBoxId; }
    time_t getReleaseTimestamp() const { return releaseTimestamp; }
    double getReleasedAmount() const { return releasedAmount; }
    string getUsername() const { return username; }
    string getTimestamp() const { return timestamp; }
 
 
-   // Save to file stream
-   void saveToFile(ofstream& file) const {
-       file << lockBoxId << "|"
-           << releaseTimestamp << "|"
-           << releasedAmount << "|"
-           << username << "|"
-           << timestamp << endl;
+   // Persisted fields, in file and loading-constructor order
+   static constexpr auto recordFields() {
+       return make_tuple(&ReleaseEvent::lockBoxId, &ReleaseEvent::releaseTimestamp,
+                         &ReleaseEvent::releasedAmount, &ReleaseEvent::username,
+                         &ReleaseEvent::timestamp);
    }
 
-
-   // Static method to load from file stream
-   static shared_ptr<ReleaseEvent> loadFromFile(ifstream& file) {
-       string line;
-       if (getline(file, line)) {
-           istringstream iss(line);
-           string token;
-           vector<string> tokens;
+   static MemoryAccount& memoryAccount() { return memoryAccounts.releaseLog; }
 
 
-           while (getline(iss, token, '|')) {
-               tokens.push_back(token);
-           }
+   // Save to file stream
+   void saveToFile(ostream& file) const {
+       RecordCodec::write(file, *this);
+   }
 
 
-           if (tokens.size() >= 5) {
-               int id = stoi(tokens[0]);
-               time_t rTimestamp = static_cast<time_t>(stoll(tokens[1]));
-               double amount = stod(tokens[2]);
-               string uname = tokens[3];
-               string ts = tokens[4];
+   // Parse a release event from one record line, nullptr if a field is missing or malformed
+   static shared_ptr<ReleaseEvent> parseRecord(const string& line) {
+       return RecordCodec::decode<ReleaseEvent>(line);
+   }
 
 
-               return make_shared<ReleaseEvent>(id, rTimestamp, amount, uname, ts);
-           }
+   // Static method to load from file stream
+   static shared_ptr<ReleaseEvent> loadFromFile(ifstream& file) {
+       string line;
+       if (getline(file, line)) {
+           return parseRecord(line);
        }
        return nullptr;
    }
-};
\ No newline at end of file
+};